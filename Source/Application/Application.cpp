@@ -5,7 +5,13 @@
 #include <Magnum/Math/Color.h>
 #include <Magnum/Math/FunctionsBatch.h>
 
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Pair.h>
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Corrade/Utility/Arguments.h>
+
 #include <Magnum/Mesh.h>
+#include <Magnum/MeshTools/BoundingVolume.h>
 #include <Magnum/PixelFormat.h>
 #include <Magnum/Primitives/Cube.h>
 #include <Magnum/Primitives/Grid.h>
@@ -17,19 +23,80 @@
 #include <Magnum/Trade/SceneData.h>
 #include <Magnum/Trade/TextureData.h>
 
+#include <GLFW/glfw3.h>
+
 #include "BasicDrawable.h"
 #include "Input.h"
 #include "Primitives.h"
+#include "RenderStats.h"
 
 using namespace Magnum;
 using Object3D = SceneGraph::Object<SceneGraph::MatrixTransformation3D>;
 using Scene3D = SceneGraph::Scene<SceneGraph::MatrixTransformation3D>;
 
+namespace
+{
+
+// Frames to render after input so that ImGui can settle hover states and layouts
+constexpr unsigned int InputSettleFrames = 3;
+
+PrimitiveMeshKey primitiveMeshKey(PrimitiveType type)
+{
+    switch (type)
+    {
+    case PrimitiveType::Plane:
+        return PrimitiveMeshKey::Plane();
+    case PrimitiveType::Cube:
+        return PrimitiveMeshKey::Cube();
+    case PrimitiveType::Sphere:
+        return PrimitiveMeshKey::Sphere();
+    case PrimitiveType::Cone:
+        return PrimitiveMeshKey::Cone();
+    case PrimitiveType::Capsule:
+        return PrimitiveMeshKey::Capsule();
+    }
+
+    CORRADE_INTERNAL_ASSERT_UNREACHABLE();
+}
+
+// Arguments the editor doesn't know about used to be ignored, so they only get a warning.
+// Unknown short options are still an error, the parser loses its place after skipping one.
+bool warnAboutArgument(const Utility::Arguments &, Utility::Arguments::ParseError error, const std::string &key)
+{
+    switch (error)
+    {
+    case Utility::Arguments::ParseError::UnknownArgument:
+        Warning{} << "Ignoring unknown command-line argument" << ("--" + key).data();
+        return true;
+    case Utility::Arguments::ParseError::SuperfluousArgument:
+        Warning{} << "Ignoring command-line argument" << key.data();
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
 // Delaring singleton pointer
 Application *Application::instance = nullptr;
 
 Application::Application(const Arguments &arguments) : Platform::Application{arguments, NoCreate}
 {
+    {
+        Utility::Arguments args;
+        args.addOption("trace", "")
+            .setHelp("trace", "record a Chrome/Perfetto trace of the whole session into the file", "FILE")
+            .addSkippedPrefix("magnum", "engine-specific options")
+            .setParseErrorCallback(warnAboutArgument)
+            .parse(arguments.argc, arguments.argv);
+
+        TraceRecorder::Shared().NameThread("Main");
+        _tracePath = args.value("trace");
+        if (!_tracePath.empty())
+            TraceRecorder::Shared().Start();
+    }
+
     /* Try 8x MSAA, fall back to zero samples if not possible. Enable only 2x
        MSAA if we have enough DPI. */
     {
@@ -51,14 +118,33 @@ Application::Application(const Arguments &arguments) : Platform::Application{arg
     /* Shaders, renderer setup */
     _vertexColorShader = Shaders::VertexColorGL3D{};
     _flatShader = Shaders::FlatGL3D{};
-    _phongShader = Shaders::PhongGL{};
+    _phongShader = Shaders::PhongGL{Shaders::PhongGL::Flag::ObjectId};
     _phongShader.setAmbientColor(0x747474_rgbf).setShininess(80.0f);
 
+    // Material is the same for all primitives, the color comes with each instance
+    _instancedPhongShader = Shaders::PhongGL{Shaders::PhongGL::Flag::InstancedTransformation |
+                                             Shaders::PhongGL::Flag::InstancedObjectId |
+                                             Shaders::PhongGL::Flag::VertexColor};
+    _instancedPhongShader.setAmbientColor(0x111111_rgbf)
+        .setShininess(80.0f)
+        .setLightPositions({Vector4{3.0f, 3.0f, 3.0f, 0.0f}});
+
+    // Same look as the scene graph primitives
+    PhongMaterial storeMaterial;
+    storeMaterial.diffuseColor = Color4{0.5f, 0.5f, 0.5f, 1.0f};
+    _storeMaterial = store.AddMaterial(storeMaterial);
+    store.jobs = &jobs;
+
     /* Grid */
-    _grid = MeshTools::compile(Primitives::grid3DWireframe({15, 15}));
+    const Trade::MeshData gridData = Primitives::grid3DWireframe({15, 15});
+    _grid = MeshTools::compile(gridData);
     auto grid = new Object3D{&_scene};
     (*grid).rotateX(90.0_degf).scale(Vector3{8.0f});
-    new FlatDrawable{*grid, _flatShader, _grid, _debugDrawables};
+    auto gridTransform = new CachedTransform{*grid, transforms};
+    auto gridDrawable = new FlatDrawable{*grid, _flatShader, _grid, _debugDrawables};
+    const Containers::Pair<Vector3, Float> gridSphere =
+        MeshTools::boundingSphereBouncingBubble(gridData.positions3DAsArray());
+    new Cullable{*grid, culler, *gridDrawable, *gridTransform, gridSphere.first(), gridSphere.second()};
     /* Grid */
 
     /* Set up the camera */
@@ -80,39 +166,205 @@ Application::Application(const Arguments &arguments) : Platform::Application{arg
     // ADD LAYERS AT THE END...
 }
 
+Application::~Application()
+{
+    // The snapshot job refers to the store and the renderer
+    jobs.Wait(_snapshotJob);
+
+    if (!_tracePath.empty())
+    {
+        TraceRecorder &trace = TraceRecorder::Shared();
+        trace.Stop();
+        if (!trace.Write(_tracePath))
+            Error{} << "Can't write the trace to" << _tracePath.data();
+    }
+}
+
+int Application::exec()
+{
+    // The first iteration sets up the event callbacks, so it always draws
+    redraw();
+    mainLoopIteration();
+
+    while (!glfwWindowShouldClose(window()))
+    {
+        // Sleep through frames nobody needs, events wake the loop up early
+        double waitSeconds;
+        if (pacer.ShouldRender(waitSeconds))
+        {
+            // Draws, then polls events
+            redraw();
+            mainLoopIteration();
+        }
+        else if (waitSeconds < 0.0)
+            glfwWaitEvents();
+        else
+            glfwWaitEventsTimeout(waitSeconds);
+    }
+
+    // Returns right away now that the window is closing, with the code given to exit()
+    return Platform::Application::exec();
+}
+
 void Application::drawEvent()
 {
-    // Input processing
-    Input::update();
+    ++_frameIndex;
+    profiler.BeginFrame(_frameIndex);
+    gpuProfiler.BeginFrame(_frameIndex);
 
-    if (Input::GetKeyDown(KeyCode::R) && !root->children().isEmpty())
     {
-        root->children().erase(root->children().last());
-        selectedObject = nullptr;
+        ProfileScope scope{profiler, "Input"};
+
+        // Input processing
+        Input::update();
+
+        jobs.BeginFrame();
+        objectIds.BeginFrame();
+        transforms.BeginFrame();
+        ObjectPool::Shared().BeginFrame();
+        RenderStats::Shared().BeginFrame();
+
+        // Picks issued in previous frames
+        _resolvePicks();
+
+        if (Input::GetKeyDown(KeyCode::R) && !root->children().isEmpty())
+        {
+            root->children().erase(root->children().last());
+        }
     }
 
+    // Layers::OnFixedUpdate(), as often as the time since the last frame asks for
+    const unsigned int fixedSteps = clock.Tick();
+    for (unsigned int step = 0; step != fixedSteps; ++step)
+        for (auto layer : layers)
+        {
+            ProfileScope scope{profiler, "OnFixedUpdate", layer->Name()};
+            layer->OnFixedUpdate();
+        }
+
     // Layers::OnUpdate()
     for (auto layer : layers)
+    {
+        ProfileScope scope{profiler, "OnUpdate", layer->Name()};
         layer->OnUpdate();
+    }
+
+    // Recompute world transformations of moved objects only, then bring the picking BVH up to
+    // date with them
+    {
+        ProfileScope scope{profiler, "Transforms"};
+        transforms.Update();
+        sceneBvh.Refit();
+        if (cpuPicking)
+            _raycastPick();
+    }
+
+    // Grab an 8x msaa buffer of the viewport size. The pool keeps the attachments alive across
+    // frames and reallocates only on real size changes.
+    renderTargets.BeginFrame();
+    viewportTarget = &renderTargets.Acquire(size, GL::RenderbufferFormat::RGBA8, pMSAA);
+
+    // Makes sure the camera matrix is up to date
+    mainCam->object().setClean();
+    _updateStoreSnapshot(mainCam->projectionMatrix() * mainCam->cameraMatrix());
+
+    // While nothing the scene pass depends on changed, the viewport keeps showing the texture
+    // resolved last time and only the GUI is redrawn
+    const ScenePassKey scenePass{mainCam->cameraMatrix(),
+                                 mainCam->projectionMatrix(),
+                                 viewportTarget,
+                                 viewportTarget->key,
+                                 viewportTarget->size,
+                                 transforms.Statistics().objects,
+                                 objectIds.Count(),
+                                 storeRenderer.Presented(),
+                                 instancing,
+                                 culler.enabled,
+                                 renderQueue.multiDraw};
+    const bool sceneChanged = transforms.Statistics().recomputed;
+    scenePassCached = cacheScenePass && !sceneChanged && scenePass == _lastScenePass;
+    _lastScenePass = scenePass;
+
+    if (scenePassCached)
+        ++scenePassesCached;
+    else
+    {
+        ProfileScope scope{profiler, "Scene pass"};
+        GpuScope gpuScope{gpuProfiler, "Scene pass"};
+        _drawScene();
+    }
+
+    // Queue an asynchronous read of the object under the cursor. The object ID attachment still
+    // holds the last scene pass.
+    if (!cpuPicking)
+    {
+        GpuScope gpuScope{gpuProfiler, "Pick"};
+        _requestPick(*viewportTarget);
+    }
 
     //================================================================================
+    // Draw on default frame buffer
+    GL::defaultFramebuffer.clear(GL::FramebufferClear::Color).bind();
 
-    // Prepare an 8x msaa buffer and render to it
-    /* 8x MSAA */
-    color = GL::Renderbuffer{};
-    depthStencil = GL::Renderbuffer{};
+    {
+        ProfileScope scope{profiler, "GUI"};
+        this->_guiBegin();
 
-    // Updating sizes
-    color.setStorageMultisample(pMSAA, GL::RenderbufferFormat::RGBA8, size);
-    depthStencil.setStorageMultisample(pMSAA, GL::RenderbufferFormat::Depth24Stencil8, size);
-    //framebufferMSAA.setViewport({{}, size});
+        // Layers::OnGuiRender()
+        for (auto layer : layers)
+        {
+            ProfileScope layerScope{profiler, "OnGuiRender", layer->Name()};
+            layer->OnGuiRender();
+        }
 
-    framebufferMSAA = GL::Framebuffer({{}, size});
-    framebufferMSAA.attachRenderbuffer(GL::Framebuffer::ColorAttachment{0}, color);
-    framebufferMSAA.attachRenderbuffer(GL::Framebuffer::BufferAttachment::DepthStencil, depthStencil);
+        ProfileScope drawScope{profiler, "ImGui draw"};
+        GpuScope gpuScope{gpuProfiler, "ImGui"};
+        this->_guiEnd();
+    }
+    //================================================================================
+
+    // Keep frames coming while there's something left to show: objects moved by the GUI, picks
+    // in flight, a store snapshot not presented yet or a blinking text cursor
+    pacer.FrameRendered();
+    if (transforms.Pending() || picker.PendingCount() || _snapshotPending || ImGui::GetIO().WantTextInput)
+        pacer.Request();
+
+    {
+        ProfileScope scope{profiler, "Swap buffers"};
+        swapBuffers();
+    }
+}
+
+void Application::_updateStoreSnapshot(const Matrix4 &projectionCamera)
+{
+    // The store is updated and extracted on a worker while frames keep drawing the last snapshot
+    // presented. Nothing waits for it here: it's presented on the first frame that finds it done,
+    // and only then the next one is started, if the store or the camera changed since.
+    if (!_snapshotJob.Done())
+        return;
+
+    if (_snapshotPending)
+    {
+        storeRenderer.Present();
+        _snapshotPending = false;
+    }
+
+    if (store.Version() == _snapshotVersion && projectionCamera == _snapshotCamera)
+        return;
+
+    _snapshotVersion = store.Version();
+    _snapshotCamera = projectionCamera;
+    _snapshotPending = true;
+    _snapshotJob = jobs.Submit([this, projectionCamera] { storeRenderer.Prepare(store, projectionCamera); });
+}
+
+void Application::_drawScene()
+{
+    GL::Framebuffer &framebufferMSAA = viewportTarget->framebufferMSAA;
 
     // Inform shader about the channels
-    framebufferMSAA.mapForDraw({{Shaders::PhongGL::ColorOutput, GL::Framebuffer::ColorAttachment{0}}});
+    framebufferMSAA.mapForDraw({{Shaders::PhongGL::ColorOutput, GL::Framebuffer::ColorAttachment{0}},
+                                {Shaders::PhongGL::ObjectIdOutput, GL::Framebuffer::ColorAttachment{1}}});
 
     // CORRADE_INTERNAL_ASSERT(framebufferMSAA.checkStatus(GL::FramebufferTarget::Draw) ==
     //                         GL::Framebuffer::Status::Complete);
@@ -120,94 +372,65 @@ void Application::drawEvent()
     framebufferMSAA.clearColor(0, Vector4{0.15f, 0.15f, 0.15f, 1.0f});
     framebufferMSAA.clearColor(1, Vector4ui{0});
 
-    framebufferMSAA.bind();
+    // Attachments are reused, so depth has to be reset explicitly
+    framebufferMSAA.clear(GL::FramebufferClear::Depth | GL::FramebufferClear::Stencil).bind();
+
+    RenderStats &renderStats = RenderStats::Shared();
+    renderStats.SetFeature(GL::Renderer::Feature::DepthTest, true);
+    renderStats.SetFeature(GL::Renderer::Feature::FaceCulling, true);
+    renderStats.SetFeature(GL::Renderer::Feature::ScissorTest, false);
+    renderStats.SetFeature(GL::Renderer::Feature::Blending, false);
 
-    GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
-    GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
-    GL::Renderer::disable(GL::Renderer::Feature::ScissorTest);
-    GL::Renderer::disable(GL::Renderer::Feature::Blending);
+    {
+        ProfileScope scope{profiler, "Scene graph"};
+        culler.BeginFrame();
+        culler.Draw(*mainCam, _drawables);
+        if (instancing)
+        {
+            instances.culling = culler.enabled;
+            instances.Draw(_instancedPhongShader, *mainCam);
+        }
+        else
+        {
+            instances.Update();
+            culler.Draw(*mainCam, _primitiveDrawables);
+        }
+    }
+    {
+        ProfileScope scope{profiler, "Scene store"};
+        storeRenderer.Draw(_instancedPhongShader, *mainCam);
+    }
+    {
+        ProfileScope scope{profiler, "Render queue"};
+        renderQueue.Flush(*mainCam);
+    }
 
-    mainCam->draw(_drawables);
-    mainCam->draw(_debugDrawables);
+    // Debug drawables don't write object IDs
+    framebufferMSAA.mapForDraw({{Shaders::PhongGL::ColorOutput, GL::Framebuffer::ColorAttachment{0}},
+                                {Shaders::PhongGL::ObjectIdOutput, GL::Framebuffer::DrawAttachment::None}});
+    culler.Draw(*mainCam, _debugDrawables);
 
     // Blit to a proxy buffer with texture
     // Display texture
-    GL::Texture2D colorTex;
-    colorTexPtr = &colorTex;
-    colorTex.setStorage(1, GL::TextureFormat::RGBA8, size);
-
-    framebufferProxy = GL::Framebuffer{{{}, size}};
-    framebufferProxy.attachTexture(GL::Framebuffer::ColorAttachment{0}, colorTex, 0);
-    framebufferProxy.clear(GL::FramebufferClear::Color | GL::FramebufferClear::Depth).bind();
-    framebufferProxy.bind();
-
-    // //////////////////
-    // // Getting the id of selected object
-    // framebufferMSAA.mapForRead(GL::Framebuffer::ColorAttachment{0});
-
-    // // Find coord on viewport buffer
-    // Vector2i coord = Input::mousePosition - (Vector2i)Vector2{viewportRectMin.x, viewportRectMin.y};
-    // // coord *= (framebufferSize() / windowSize());
-    // coord[1] = size[1] - coord[1]; // Invert Y
-
-    // Debug{} << "Coords  :" << coord;
-
-    // Image2D data{PixelFormat::RGBA8Unorm};
-    // framebufferMSAA.read(Range2Di::fromSize(coord, {1, 1}), data);
-
-    // Debug{} << "Data    :" << data.data();
-
-    // uint32_t idx = 0;
-    // if (indexPixelFormat == PixelFormat::R8UI)
-    // {
-    //     idx = static_cast<uint32_t>(data.data()[0]);
-    // }
-    // else if (indexPixelFormat == PixelFormat::R16UI)
-    // {
-    //     idx = static_cast<uint32_t>(Containers::arrayCast<uint16_t>(data.data())[0]);
-    // }
-    // else if (indexPixelFormat == PixelFormat::R32UI)
-    // {
-    //     idx = Containers::arrayCast<uint32_t>(data.data())[0];
-    // }
-    // else
-    // {
-    //     Fatal{} << "Invalid pixel format";
-    // }
-
-    // Debug{} << "Object ID: " << idx;
-    // //////////////////////
+    GL::Framebuffer &framebufferProxy = viewportTarget->framebufferProxy;
 
     // Read the color chanel
     framebufferMSAA.mapForRead(GL::Framebuffer::ColorAttachment{0});
 
     // Blitting to the default framebuffer
+    GpuScope gpuScope{gpuProfiler, "Resolve blit"};
     GL::AbstractFramebuffer::blit(framebufferMSAA, framebufferProxy, framebufferMSAA.viewport(),
                                   GL::FramebufferBlit::Color);
 
     // // Blitting to the default framebuffer
     // GL::AbstractFramebuffer::blit(framebuffer, GL::defaultFramebuffer, framebuffer.viewport(),
     //                               GL::FramebufferBlit::Color);
-
-    //================================================================================
-    // Draw on default frame buffer
-    GL::defaultFramebuffer.clear(GL::FramebufferClear::Color).bind();
-
-    this->_guiBegin();
-
-    // Layers::OnGuiRender()
-    for (auto layer : layers)
-        layer->OnGuiRender();
-
-    this->_guiEnd();
-    //================================================================================
-
-    swapBuffers();
-    redraw();
 }
 
 void Application::viewportEvent(ViewportEvent &event)
 {
+    pacer.Request(InputSettleFrames);
+
     GL::defaultFramebuffer.setViewport({{}, event.framebufferSize()});
 
     //================================================================================
@@ -221,6 +444,8 @@ void Application::viewportEvent(ViewportEvent &event)
 
 void Application::keyPressEvent(KeyEvent &event)
 {
+    pacer.Request(InputSettleFrames);
+
     Input::updateDown(event.key());
 
     //================================================================================
@@ -235,6 +460,8 @@ void Application::keyPressEvent(KeyEvent &event)
 
 void Application::keyReleaseEvent(KeyEvent &event)
 {
+    pacer.Request(InputSettleFrames);
+
     Input::updateUp(event.key());
 
     //================================================================================
@@ -249,6 +476,8 @@ void Application::keyReleaseEvent(KeyEvent &event)
 
 void Application::mousePressEvent(MouseEvent &event)
 {
+    pacer.Request(InputSettleFrames);
+
     Input::updateMouseButtonDown(event.button());
 
     if (mouseOverViewport)
@@ -266,6 +495,8 @@ void Application::mousePressEvent(MouseEvent &event)
 
 void Application::mouseReleaseEvent(MouseEvent &event)
 {
+    pacer.Request(InputSettleFrames);
+
     Input::updateMouseButtonUp(event.button());
 
     usingViewport = false;
@@ -282,6 +513,8 @@ void Application::mouseReleaseEvent(MouseEvent &event)
 
 void Application::mouseMoveEvent(MouseMoveEvent &event)
 {
+    pacer.Request(InputSettleFrames);
+
     //================================================================================
 
     if (_imgui.handleMouseMoveEvent(event) != Application::singleton()->mouseOverViewport)
@@ -294,6 +527,8 @@ void Application::mouseMoveEvent(MouseMoveEvent &event)
 
 void Application::mouseScrollEvent(MouseScrollEvent &event)
 {
+    pacer.Request(InputSettleFrames);
+
     if (_imgui.handleMouseScrollEvent(event))
     {
         /* Prevent scrolling the page */
@@ -308,6 +543,8 @@ void Application::mouseScrollEvent(MouseScrollEvent &event)
 
 void Application::textInputEvent(TextInputEvent &event)
 {
+    pacer.Request(InputSettleFrames);
+
     if (_imgui.handleTextInputEvent(event))
         event.setAccepted(true);
 
@@ -425,12 +662,25 @@ void Application::_guiEnd()
 
     /* Set appropriate states. If you only draw ImGui, it is sufficient to
        just enable blending and scissor test in the constructor. */
-    GL::Renderer::enable(GL::Renderer::Feature::Blending);
-    GL::Renderer::enable(GL::Renderer::Feature::ScissorTest);
-    GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
-    GL::Renderer::disable(GL::Renderer::Feature::DepthTest);
+    RenderStats &renderStats = RenderStats::Shared();
+    renderStats.SetFeature(GL::Renderer::Feature::Blending, true);
+    renderStats.SetFeature(GL::Renderer::Feature::ScissorTest, true);
+    renderStats.SetFeature(GL::Renderer::Feature::FaceCulling, false);
+    renderStats.SetFeature(GL::Renderer::Feature::DepthTest, false);
 
     _imgui.drawFrame();
+
+    // The integration uploads the whole draw data every frame, sets the projection once and
+    // binds a texture for every command
+    const ImDrawData &drawData = *ImGui::GetDrawData();
+    std::size_t commands = 0;
+    for (int i = 0; i != drawData.CmdListsCount; ++i)
+        commands += drawData.CmdLists[i]->CmdBuffer.Size;
+    renderStats.ForgetShader();
+    renderStats.UniformsSet();
+    renderStats.TexturesBound(commands);
+    renderStats.Uploaded(drawData.TotalVtxCount * sizeof(ImDrawVert) + drawData.TotalIdxCount * sizeof(ImDrawIdx));
+    renderStats.ExternalDraws(commands, drawData.TotalIdxCount / 3, drawData.TotalIdxCount);
 }
 
 void Application::_guiDrawViewport()
@@ -475,18 +725,23 @@ void Application::_guiDrawViewport()
     Application::singleton()->size = (Vector2i)(Vector2)ImGui::GetContentRegionMax();
     Application::singleton()->mainCam->setViewport(Application::singleton()->size);
 
-    Magnum::ImGuiIntegration::image(*Application::singleton()->colorTexPtr, (Vector2)ImGui::GetContentRegionAvail());
+    if (viewportTarget != nullptr)
+        Magnum::ImGuiIntegration::image(viewportTarget->colorTex, (Vector2)ImGui::GetContentRegionAvail(),
+                                        viewportTarget->UvRange());
 
     // Layers::OnViewportRender()
     for (auto layer : layers)
+    {
+        ProfileScope scope{profiler, "OnViewportRender", layer->Name()};
         layer->OnViewportRender();
+    }
 
     // Transform handling (IMGUIZMO DRAWING)
-    if (selectedObject != nullptr)
+    if (Object3D *selected = SelectedObject())
     {
-        Matrix4 mat = Application::singleton()->selectedObject->transformation();
+        Matrix4 mat = selected->transformation();
         if (Application::singleton()->EditTransform(mat))
-            Application::singleton()->selectedObject->setTransformation(mat);
+            TransformCache::SetTransformation(*selected, mat);
     }
 
     ImGui::EndChild();
@@ -496,36 +751,166 @@ void Application::_guiDrawViewport()
 
 void Application::AddPlane()
 {
-    selectedObject = new Plane{*root, _phongShader, _drawables};
+    Select(new Plane{*root, _phongShader, _primitiveDrawables});
 }
 
 void Application::AddCube()
 {
-    selectedObject = new Cube{*root, _phongShader, _drawables};
+    Select(new Cube{*root, _phongShader, _primitiveDrawables});
 }
 
 void Application::AddSphere()
 {
-    selectedObject = new Sphere{*root, _phongShader, _drawables};
+    Select(new Sphere{*root, _phongShader, _primitiveDrawables});
 }
 
 void Application::AddCone()
 {
-    selectedObject = new Cone{*root, _phongShader, _drawables};
+    Select(new Cone{*root, _phongShader, _primitiveDrawables});
 }
 
 void Application::AddCapsule()
 {
-    selectedObject = new Capsule{*root, _phongShader, _drawables};
+    Select(new Capsule{*root, _phongShader, _primitiveDrawables});
+}
+
+void Application::Spawn(PrimitiveType type, const std::vector<Matrix4> &transformations,
+                        const std::vector<Color4> &colors)
+{
+    CORRADE_ASSERT(colors.empty() || colors.size() == transformations.size(),
+                   "Application::Spawn(): expected" << transformations.size() << "colors but got" << colors.size(), );
+
+    const std::size_t count = transformations.size();
+    if (!count)
+        return;
+
+    const MeshHandle mesh = meshLibrary.Get(primitiveMeshKey(type));
+
+    ObjectPool &pool = ObjectPool::Shared();
+    pool.Reserve(sizeof(Primitive), count);
+    pool.Reserve(sizeof(CachedTransform), count);
+    pool.Reserve(sizeof(BvhPickable), count);
+    pool.Reserve(sizeof(InstancedDrawable), count);
+    pool.Reserve(sizeof(Cullable), count);
+    instances.Reserve(mesh, count);
+
+    const UnsignedInt firstId = objectIds.ReserveRange(count);
+    for (std::size_t i = 0; i != count; ++i)
+    {
+        auto primitive = new Primitive{*root,     _phongShader, _primitiveDrawables, mesh,
+                                       colors.empty() ? Primitive::DefaultColor : colors[i], UnsignedInt(firstId + i)};
+        primitive->setTransformation(transformations[i]);
+    }
+}
+
+SceneHandle Application::AddPlane(const Matrix4 &transformation)
+{
+    return _addToStore(PrimitiveMeshKey::Plane(), transformation);
+}
+
+SceneHandle Application::AddCube(const Matrix4 &transformation)
+{
+    return _addToStore(PrimitiveMeshKey::Cube(), transformation);
+}
+
+SceneHandle Application::AddSphere(const Matrix4 &transformation)
+{
+    return _addToStore(PrimitiveMeshKey::Sphere(), transformation);
+}
+
+SceneHandle Application::AddCone(const Matrix4 &transformation)
+{
+    return _addToStore(PrimitiveMeshKey::Cone(), transformation);
+}
+
+SceneHandle Application::AddCapsule(const Matrix4 &transformation)
+{
+    return _addToStore(PrimitiveMeshKey::Capsule(), transformation);
 }
 
-uint32_t Application::_getUniqueID()
+std::vector<SceneHandle> Application::AddToStore(PrimitiveType type, const std::vector<Matrix4> &transformations)
 {
-    static uint64_t id = 0;
-    id++;
+    std::vector<SceneHandle> handles;
+    handles.reserve(transformations.size());
+
+    jobs.Wait(_snapshotJob);
+    const MeshHandle mesh = meshLibrary.Get(primitiveMeshKey(type));
+    for (const Matrix4 &transformation : transformations)
+        handles.push_back(store.Create(mesh, _storeMaterial, transformation));
 
-    Debug{} << id;
+    RequestFrame();
+    return handles;
+}
 
-    // Start from zero
-    return id - 1;
+SceneHandle Application::_addToStore(const PrimitiveMeshKey &key, const Matrix4 &transformation)
+{
+    jobs.Wait(_snapshotJob);
+    RequestFrame();
+    return store.Create(meshLibrary.Get(key), _storeMaterial, transformation);
+}
+
+void Application::_raycastPick()
+{
+    if (!mouseOverViewport)
+    {
+        hoveredObject = {};
+        return;
+    }
+
+    // Cursor position in normalized device coordinates, Y up
+    const ImVec2 mouse = ImGui::GetIO().MousePos;
+    const Vector2 position{mouse.x - viewportRectMin.x, mouse.y - viewportRectMin.y};
+    const Vector2 ndc = position / Vector2{size} * Vector2{2.0f, -2.0f} + Vector2{-1.0f, 1.0f};
+
+    // Ray from the near to the far plane in world space
+    const Matrix4 unproject = (mainCam->projectionMatrix() * mainCam->cameraMatrix()).inverted();
+    const Vector3 near = unproject.transformPoint({ndc, -1.0f});
+    const Vector3 far = unproject.transformPoint({ndc, 1.0f});
+
+    SceneBvh::Hit hit;
+    hoveredObject = sceneBvh.Raycast(near, far - near, hit) ? objectIds.HandleOf(hit.object) : ObjectHandle{};
+
+    // Clicking empty space clears the selection
+    if (Input::GetMouseButtonDown(MouseEvent::Button::Left) && !ImGuizmo::IsOver() && !ImGuizmo::IsUsing())
+        selectedObject = hoveredObject;
+}
+
+void Application::_requestPick(RenderTarget &target)
+{
+    if (!mouseOverViewport)
+    {
+        hoveredObject = {};
+        return;
+    }
+
+    // Cursor position in the rendered sub-rectangle, Y up
+    const ImVec2 mouse = ImGui::GetIO().MousePos;
+    const Vector2i pixel{Int(mouse.x - viewportRectMin.x), target.size.y() - 1 - Int(mouse.y - viewportRectMin.y)};
+    if (!(pixel >= Vector2i{0}).all() || !(pixel < target.size).all())
+        return;
+
+    if (Input::GetMouseButtonDown(MouseEvent::Button::Left) && !ImGuizmo::IsOver() && !ImGuizmo::IsUsing())
+        _pickClickPending = true;
+
+    // Integer attachments can't be averaged, the blit picks a single sample of the pixel
+    target.framebufferMSAA.mapForRead(GL::Framebuffer::ColorAttachment{1});
+    GL::AbstractFramebuffer::blit(target.framebufferMSAA, target.framebufferObjectId,
+                                  Range2Di::fromSize(pixel, Vector2i{1}), GL::FramebufferBlit::Color);
+
+    // A click that doesn't fit into the ring is retried next frame
+    const ObjectPicker::Kind kind = _pickClickPending ? ObjectPicker::Kind::Click : ObjectPicker::Kind::Hover;
+    if (picker.Request(target.framebufferObjectId, pixel, kind, _frameIndex) && kind == ObjectPicker::Kind::Click)
+        _pickClickPending = false;
+}
+
+void Application::_resolvePicks()
+{
+    for (const ObjectPicker::Result &result : picker.Poll())
+    {
+        hoveredObject = objectIds.HandleOf(objectIds.Find(result.id));
+
+        // Clicking empty space clears the selection
+        if (result.kind == ObjectPicker::Kind::Click)
+            selectedObject = hoveredObject;
+    }
 }
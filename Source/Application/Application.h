@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include <Magnum/Math/Matrix4.h>
 
 #include <Magnum/GL/MultisampleTexture.h>
@@ -31,7 +33,23 @@
 #include <Magnum/ImGuiIntegration/Context.hpp>
 #include <Magnum/ImGuiIntegration/Widgets.h>
 
+#include "FrameClock.h"
+#include "FramePacer.h"
+#include "FrustumCuller.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "InstanceRenderer.h"
+#include "JobSystem.h"
 #include "MainCamera.h"
+#include "MeshLibrary.h"
+#include "ObjectIdRegistry.h"
+#include "ObjectPicker.h"
+#include "RenderQueue.h"
+#include "RenderTargetPool.h"
+#include "SceneBvh.h"
+#include "SceneStore.h"
+#include "SceneStoreRenderer.h"
+#include "TransformCache.h"
 
 #include "LayerStack.h"
 
@@ -70,19 +88,50 @@ class Application : public Magnum::Platform::Application
 {
   public:
     explicit Application(const Arguments &arguments);
+    ~Application();
+
+    // Replaces the main loop of the base class, which only knows to draw continuously or to
+    // block until the next event. Frames are drawn when the pacer says one is due, in between
+    // the loop waits for events, at most until the next idle frame or the frame rate cap allow
+    // one.
+    int exec();
 
     static Application *singleton()
     {
         return instance;
     }
 
+    // Layers that animate call this on every update to keep frames coming when rendering on
+    // demand
+    void RequestFrame(unsigned int frames = 1)
+    {
+        pacer.Request(frames);
+    }
+
     bool EditTransform(Magnum::Matrix4 &matrix);
     void AddPlane();
     void AddCube();
     void AddSphere();
     void AddCone();
     void AddCapsule();
-    uint32_t _getUniqueID();
+
+    // Adds one selectable primitive for each transformation, all sharing the mesh lookup, a
+    // single range of object IDs and one growth of the pool and the instance batch. Colors
+    // default to the one of single primitives; if given, there has to be one per transformation.
+    void Spawn(PrimitiveType type, const std::vector<Magnum::Matrix4> &transformations,
+               const std::vector<Magnum::Color4> &colors = {});
+
+    // Primitives in the scene store, for scenes too large for the scene graph. They are drawn
+    // and culled in bulk, but can't be selected or edited like the ones above. The store is
+    // prepared for drawing on a worker across frames, so these wait for that to finish first.
+    SceneHandle AddPlane(const Magnum::Matrix4 &transformation);
+    SceneHandle AddCube(const Magnum::Matrix4 &transformation);
+    SceneHandle AddSphere(const Magnum::Matrix4 &transformation);
+    SceneHandle AddCone(const Magnum::Matrix4 &transformation);
+    SceneHandle AddCapsule(const Magnum::Matrix4 &transformation);
+
+    // Adds one store primitive for each transformation, waiting only once
+    std::vector<SceneHandle> AddToStore(PrimitiveType type, const std::vector<Magnum::Matrix4> &transformations);
 
   private:
     void drawEvent() override;
@@ -105,6 +154,12 @@ class Application : public Magnum::Platform::Application
     void _guiDrawViewport();
 
     // Utility functions
+    void _drawScene();
+    void _raycastPick();
+    void _requestPick(RenderTarget &target);
+    void _resolvePicks();
+    SceneHandle _addToStore(const PrimitiveMeshKey &key, const Magnum::Matrix4 &transformation);
+    void _updateStoreSnapshot(const Magnum::Matrix4 &projectionCamera);
 
   public:
     //================================================================================
@@ -114,22 +169,54 @@ class Application : public Magnum::Platform::Application
     Magnum::Shaders::VertexColorGL3D _vertexColorShader{Corrade::NoCreate};
     Magnum::Shaders::FlatGL3D _flatShader{Corrade::NoCreate};
     Magnum::Shaders::PhongGL _phongShader{Corrade::NoCreate};
+    Magnum::Shaders::PhongGL _instancedPhongShader{Corrade::NoCreate};
     Magnum::GL::Mesh _grid{Corrade::NoCreate};
+
+    // Declared first so workers outlive every system that may have jobs in flight
+    JobSystem jobs;
+
+    // Declared before the scene so objects can still unregister and release their meshes while
+    // the scene is destroyed
+    MeshLibrary meshLibrary;
+    ObjectIdRegistry objectIds;
+    TransformCache transforms;
+    SceneBvh sceneBvh;
+    InstanceRenderer instances;
+    FrustumCuller culler;
+
+    // Objects that live outside of the scene graph
+    SceneStore store;
+    SceneStoreRenderer storeRenderer;
+    Magnum::UnsignedInt _storeMaterial = 0;
+
+    // Snapshot being prepared, and the store version and camera it was started with
+    JobHandle _snapshotJob;
+    unsigned long long _snapshotVersion = ~0ull;
+    Magnum::Matrix4 _snapshotCamera;
+    bool _snapshotPending = false; // prepared but not presented yet
+
     Magnum::Scene3D _scene;
     Magnum::Object3D *root;
     Magnum::SceneGraph::DrawableGroup3D _drawables;
+    Magnum::SceneGraph::DrawableGroup3D _primitiveDrawables; // Drawn one by one when not instancing
     Magnum::SceneGraph::DrawableGroup3D _debugDrawables;
     Magnum::MainCamera *mainCam;
 
+    // Draw primitives sharing a mesh with a single instanced draw call
+    bool instancing = true;
+
+    // Phong drawables submit here instead of drawing directly
+    RenderQueue renderQueue;
+
     // Buffers
-    Magnum::GL::Renderbuffer color{Corrade::NoCreate};
-    Magnum::GL::Renderbuffer depthStencil{Corrade::NoCreate};
-    Magnum::GL::Framebuffer framebufferMSAA{Corrade::NoCreate};
-    Magnum::GL::Framebuffer framebufferProxy{Corrade::NoCreate};
+    RenderTargetPool renderTargets;
+    RenderTarget *viewportTarget = nullptr;
 
-    // Object index format
-    Magnum::GL::RenderbufferFormat indexBufferFormat{Magnum::GL::RenderbufferFormat::R16UI};
-    Magnum::PixelFormat indexPixelFormat{Magnum::PixelFormat::R16UI};
+    // Object picking, either by casting rays against sceneBvh or by reading the object ID
+    // attachment back from the GPU
+    bool cpuPicking = true;
+    ObjectPicker picker;
+    ObjectHandle hoveredObject;
 
     int pMSAA = 8;
     bool mouseOverViewport = false;
@@ -139,21 +226,78 @@ class Application : public Magnum::Platform::Application
     ImGuizmo::OPERATION mCurrentGizmoOperation = ImGuizmo::ROTATE;
     ImGuizmo::MODE mCurrentGizmoMode = ImGuizmo::LOCAL;
 
-    Object3D *selectedObject = nullptr;
+    // Handles instead of pointers, objects can be deleted while selected
+    ObjectHandle selectedObject;
+
+    // Null once the object is gone
+    Object3D *SelectedObject() const
+    {
+        return objectIds.Resolve(selectedObject);
+    }
+
+    Object3D *HoveredObject() const
+    {
+        return objectIds.Resolve(hoveredObject);
+    }
+
+    void Select(Object3D *object)
+    {
+        selectedObject = objectIds.HandleOf(object);
+    }
 
     // Display size
     Magnum::Vector2i size{500, 500};
 
-    Magnum::GL::Texture2D *colorTexPtr;
+    FrameClock clock;
+    FramePacer pacer;
+    CpuProfiler profiler;
+    GpuProfiler gpuProfiler;
+
+    // Reuse the last scene pass while camera, objects, viewport and render settings stay the same
+    bool cacheScenePass = true;
+    bool scenePassCached = false; // this frame
+    std::size_t scenePassesCached = 0;
 
     LayerStack layers;
 
   private:
+    // Everything the scene pass depends on, besides objects moving
+    struct ScenePassKey
+    {
+        Magnum::Matrix4 camera;
+        Magnum::Matrix4 projection;
+        RenderTarget *target = nullptr;
+        RenderTargetKey targetKey{};
+        Magnum::Vector2i targetSize;
+        std::size_t objects = 0;
+        std::size_t registeredObjects = 0;
+        unsigned long long storeSnapshot = 0;
+        bool instancing = false;
+        bool culling = false;
+        bool multiDraw = false;
+
+        bool operator==(const ScenePassKey &other) const
+        {
+            return camera == other.camera && projection == other.projection && target == other.target &&
+                   targetKey == other.targetKey && targetSize == other.targetSize && objects == other.objects &&
+                   registeredObjects == other.registeredObjects && storeSnapshot == other.storeSnapshot &&
+                   instancing == other.instancing && culling == other.culling && multiDraw == other.multiDraw;
+        }
+    };
+
     static Application *instance;
 
+    ScenePassKey _lastScenePass;
+
+    unsigned long long _frameIndex = 0;
+    bool _pickClickPending = false;
+
     Magnum::ImGuiIntegration::Context _imgui{Corrade::NoCreate};
     bool _showDemoWindow = true;
     bool _showAnotherWindow = false;
     Magnum::Color4 _clearColor = Magnum::Color4(0.1f, 0.1f, 0.1f, 1.0f);
     Magnum::Float _floatValue = 0.0f;
+
+    // Given by --trace, the session is recorded into it
+    std::string _tracePath;
 };
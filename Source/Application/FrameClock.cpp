@@ -0,0 +1,33 @@
+#include "FrameClock.h"
+
+#include <algorithm>
+#include <cmath>
+
+unsigned int FrameClock::Tick()
+{
+    const Clock::time_point now = Clock::now();
+    _delta = std::min(std::chrono::duration<double>(now - _last).count(), double(maxDeltaSeconds));
+    _last = now;
+    _time += _delta;
+
+    const double step = 1.0 / double(fixedUpdatesPerSecond);
+    _accumulator += _delta;
+
+    unsigned int steps = 0;
+    while (_accumulator >= step && steps < maxFixedSteps)
+    {
+        _accumulator -= step;
+        ++steps;
+    }
+
+    // Falling behind, give up on the time that didn't fit
+    if (_accumulator >= step)
+    {
+        _stats.droppedSteps += std::size_t(_accumulator / step);
+        _accumulator = std::fmod(_accumulator, step);
+    }
+
+    _stats.fixedSteps = steps;
+    _alpha = float(_accumulator / step);
+    return steps;
+}
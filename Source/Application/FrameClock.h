@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// Engine time. Tick() once per frame measures the frame's delta time and feeds it into a
+// fixed-timestep accumulator, which says how many fixed updates are due. Simulation that runs
+// in fixed updates behaves the same at any frame rate; what's left in the accumulator gives
+// the factor to interpolate between the last two fixed states for rendering.
+class FrameClock
+{
+  public:
+    struct Stats
+    {
+        unsigned int fixedSteps = 0;   // this frame
+        std::size_t droppedSteps = 0; // in total, because of maxFixedSteps
+    };
+
+    // Returns the number of fixed updates to run this frame
+    unsigned int Tick();
+
+    // Of the last frame, at most maxDeltaSeconds
+    float DeltaSeconds() const
+    {
+        return float(_delta);
+    }
+
+    // Sum of all deltas since the clock started
+    double TimeSeconds() const
+    {
+        return _time;
+    }
+
+    float FixedDeltaSeconds() const
+    {
+        return 1.0f / fixedUpdatesPerSecond;
+    }
+
+    // How far the current time is between the last fixed update and the next one, in [0, 1)
+    float Alpha() const
+    {
+        return _alpha;
+    }
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    float fixedUpdatesPerSecond = 60.0f;
+
+    // Longer frames, such as after idling on demand or in a debugger, count as this long
+    float maxDeltaSeconds = 0.25f;
+
+    // Steps beyond this are dropped instead of making the next frame even longer
+    unsigned int maxFixedSteps = 8;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point _last = Clock::now();
+    double _time = 0.0;
+    double _accumulator = 0.0;
+    double _delta = 0.0; // kept in double so the time sums don't lose precision
+    float _alpha = 0.0f;
+    Stats _stats;
+};
@@ -0,0 +1,55 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+
+void FramePacer::Request(unsigned int frames)
+{
+    _requested = std::max(_requested, frames);
+}
+
+bool FramePacer::ShouldRender(double &waitSeconds)
+{
+    const Clock::time_point now = Clock::now();
+    const double sinceLastFrame = std::chrono::duration<double>(now - _lastFrame).count();
+
+    bool due = !onDemand || _requested;
+    waitSeconds = -1.0;
+    if (!due && idleFramesPerSecond > 0.0f)
+    {
+        const double idlePeriod = 1.0 / double(idleFramesPerSecond);
+        due = sinceLastFrame >= idlePeriod;
+        waitSeconds = idlePeriod - sinceLastFrame;
+    }
+
+    if (due && maxFramesPerSecond > 0.0f)
+    {
+        const double minPeriod = 1.0 / double(maxFramesPerSecond);
+        if (sinceLastFrame < minPeriod)
+        {
+            due = false;
+            waitSeconds = minPeriod - sinceLastFrame;
+        }
+    }
+
+    if (!due)
+        ++_stats.skippedFrames;
+    return due;
+}
+
+void FramePacer::FrameRendered()
+{
+    _lastFrame = Clock::now();
+    if (_requested)
+        --_requested;
+    ++_stats.renderedFrames;
+
+    // Averaged over half a second, on demand there can be long gaps between frames
+    ++_framesSinceRateStart;
+    const double elapsed = std::chrono::duration<double>(_lastFrame - _rateStart).count();
+    if (elapsed >= 0.5)
+    {
+        _stats.framesPerSecond = _framesSinceRateStart / elapsed;
+        _framesSinceRateStart = 0;
+        _rateStart = _lastFrame;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// Decides when the application produces a frame. Rendering continuously is the default; with
+// onDemand set a frame is only made when something asked for one, such as input, an animating
+// layer or a moved object, plus once every idle period if there's an idle rate. The frame rate
+// cap applies either way.
+class FramePacer
+{
+  public:
+    struct Stats
+    {
+        std::size_t renderedFrames = 0;
+        std::size_t skippedFrames = 0; // wake-ups that didn't produce a frame
+        double framesPerSecond = 0.0;
+    };
+
+    // Asks for at least this many more frames
+    void Request(unsigned int frames = 1);
+
+    // Whether to produce a frame now. If not, sets waitSeconds to how long until one is due, or
+    // to a negative value if there's nothing to wait for but the next event.
+    bool ShouldRender(double &waitSeconds);
+
+    // Call once the frame was produced
+    void FrameRendered();
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    bool onDemand = false;
+    float maxFramesPerSecond = 0.0f;  // zero for no cap
+    float idleFramesPerSecond = 0.0f; // zero to sleep until the next event
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    unsigned int _requested = 0;
+    Clock::time_point _lastFrame = Clock::now();
+    Clock::time_point _rateStart = Clock::now();
+    std::size_t _framesSinceRateStart = 0;
+    Stats _stats;
+};
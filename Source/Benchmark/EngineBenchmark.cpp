@@ -0,0 +1,246 @@
+// Microbenchmarks of CPU work the editor does every frame, or every time an object is added.
+// Every benchmark runs a batch of iterations many times over; the tester reports the mean and
+// standard deviation of the batches. To compare two builds, run both on an otherwise idle
+// machine pinned to one core, e.g.
+//
+//   taskset -c 2 ./EngineBenchmark --benchmark-discard 10 --repeat-every 5
+//
+// and treat differences smaller than a couple of standard deviations as noise.
+
+#include <memory>
+#include <vector>
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/TestSuite/Tester.h>
+
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/SceneGraph/Scene.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "Input.h"
+#include "LayerStack.h"
+#include "MeshBvh.h"
+#include "MeshLibrary.h"
+#include "TransformCache.h"
+
+using namespace Corrade;
+using namespace Magnum;
+using Scene3D = SceneGraph::Scene<SceneGraph::MatrixTransformation3D>;
+
+namespace
+{
+
+// Batches per benchmark, the first few are discarded as warmup by the tester
+constexpr std::size_t Repeats = 100;
+
+// About what a busy editor scene has, in the same eight-way hierarchy as BenchmarkPropagation()
+constexpr std::size_t SceneObjects = 10000;
+constexpr std::size_t Branching = 8;
+
+// The layers main() pushes, plus a few more a project typically adds
+constexpr std::size_t LayerCount = 8;
+
+const struct
+{
+    const char *name;
+    PrimitiveMeshKey key;
+} PrimitiveData[]{{"plane", PrimitiveMeshKey::Plane()},
+                  {"cube", PrimitiveMeshKey::Cube()},
+                  {"sphere", PrimitiveMeshKey::Sphere()},
+                  {"cone", PrimitiveMeshKey::Cone()},
+                  {"capsule", PrimitiveMeshKey::Capsule()}};
+
+// Does about as little as a layer with nothing to do this frame, through a call the compiler
+// can't see through
+class CountingLayer : public Layer
+{
+  public:
+    void OnFixedUpdate() override
+    {
+        ++calls;
+    }
+
+    void OnUpdate() override
+    {
+        ++calls;
+    }
+
+    void OnGuiRender() override
+    {
+        ++calls;
+    }
+
+    void OnViewportRender() override
+    {
+        ++calls;
+    }
+
+    std::size_t calls = 0;
+};
+
+} // namespace
+
+struct EngineBenchmark : TestSuite::Tester
+{
+    explicit EngineBenchmark();
+
+    void inputUpdateIdle();
+    void inputUpdateTyping();
+
+    void layerStackDispatch();
+
+    void transformsSetupScene();
+    void transformsTeardownScene();
+    void transformsMoveRoot();
+    void transformsMoveLeaves();
+
+    void primitiveGeneration();
+
+  private:
+    std::unique_ptr<Scene3D> _scene;
+    std::unique_ptr<TransformCache> _transforms;
+    std::vector<Object3D *> _objects;
+};
+
+EngineBenchmark::EngineBenchmark()
+{
+    Input::Init(nullptr);
+
+    addBenchmarks({&EngineBenchmark::inputUpdateIdle, &EngineBenchmark::inputUpdateTyping,
+                   &EngineBenchmark::layerStackDispatch},
+                  Repeats);
+
+    addBenchmarks({&EngineBenchmark::transformsMoveRoot, &EngineBenchmark::transformsMoveLeaves}, Repeats,
+                  &EngineBenchmark::transformsSetupScene, &EngineBenchmark::transformsTeardownScene);
+
+    addInstancedBenchmarks({&EngineBenchmark::primitiveGeneration}, Repeats, Containers::arraySize(PrimitiveData));
+}
+
+void EngineBenchmark::inputUpdateIdle()
+{
+    // Nothing pressed, the usual frame
+    CORRADE_BENCHMARK(1000)
+    {
+        Input::update();
+    }
+
+    CORRADE_VERIFY(Input::clearGroupDown.empty());
+}
+
+void EngineBenchmark::inputUpdateTyping()
+{
+    // A key goes down and another one up every frame
+    int frame = 0;
+    CORRADE_BENCHMARK(1000)
+    {
+        Input::updateDown(KeyCode(int(KeyCode::A) + frame % 26));
+        Input::updateUp(KeyCode(int(KeyCode::A) + (frame + 13) % 26));
+        Input::update();
+        ++frame;
+    }
+
+    CORRADE_COMPARE(Input::clearGroupDown.size(), 1);
+}
+
+void EngineBenchmark::layerStackDispatch()
+{
+    std::vector<std::unique_ptr<CountingLayer>> layers;
+    LayerStack stack;
+    for (std::size_t i = 0; i != LayerCount; ++i)
+    {
+        layers.emplace_back(new CountingLayer);
+        stack.PushLayer(layers.back().get());
+    }
+
+    // The callbacks drawEvent() makes with one fixed step
+    CORRADE_BENCHMARK(1000)
+    {
+        for (Layer *layer : stack)
+            layer->OnFixedUpdate();
+        for (Layer *layer : stack)
+            layer->OnUpdate();
+        for (Layer *layer : stack)
+            layer->OnGuiRender();
+        for (Layer *layer : stack)
+            layer->OnViewportRender();
+    }
+
+    CORRADE_COMPARE(layers.front()->calls, 4000);
+}
+
+void EngineBenchmark::transformsSetupScene()
+{
+    _scene.reset(new Scene3D);
+    _transforms.reset(new TransformCache);
+    _objects.clear();
+    _objects.reserve(SceneObjects);
+    for (std::size_t i = 0; i != SceneObjects; ++i)
+    {
+        Object3D *parent = i ? _objects[(i - 1) / Branching] : _scene.get();
+        auto object = new Object3D{parent};
+        object->setTransformation(Matrix4::translation({1.0f, 0.5f, -0.25f}) * Matrix4::rotationZ(Deg(Float(i % 13))));
+        new CachedTransform{*object, *_transforms};
+        _objects.push_back(object);
+    }
+    _transforms->Update();
+}
+
+void EngineBenchmark::transformsTeardownScene()
+{
+    // Features unregister from the cache, so the scene goes first
+    _objects.clear();
+    _scene = nullptr;
+    _transforms = nullptr;
+}
+
+void EngineBenchmark::transformsMoveRoot()
+{
+    // Every object is recomputed
+    Float angle = 0.0f;
+    CORRADE_BENCHMARK(10)
+    {
+        angle += 1.0f;
+        TransformCache::SetTransformation(*_objects.front(), Matrix4::rotationY(Deg(angle)));
+        _transforms->BeginFrame();
+        _transforms->Update();
+    }
+
+    CORRADE_COMPARE(_transforms->Statistics().recomputed, SceneObjects);
+}
+
+void EngineBenchmark::transformsMoveLeaves()
+{
+    // A hundred objects at the bottom of the hierarchy move, like a few animated props
+    const std::size_t moved = 100;
+    Float angle = 0.0f;
+    CORRADE_BENCHMARK(10)
+    {
+        angle += 1.0f;
+        for (std::size_t i = SceneObjects - moved; i != SceneObjects; ++i)
+            TransformCache::SetTransformation(*_objects[i], Matrix4::rotationY(Deg(angle)));
+        _transforms->BeginFrame();
+        _transforms->Update();
+    }
+
+    CORRADE_COMPARE(_transforms->Statistics().recomputed, moved);
+}
+
+void EngineBenchmark::primitiveGeneration()
+{
+    // The CPU part of what a primitive constructor triggers when its mesh isn't in the library
+    // yet. Uploading to the GPU isn't measured.
+    const auto &data = PrimitiveData[testCaseInstanceId()];
+    setTestCaseDescription(data.name);
+
+    std::size_t triangles = 0;
+    CORRADE_BENCHMARK(10)
+    {
+        const Trade::MeshData mesh = GeneratePrimitiveMesh(data.key);
+        const MeshBvh bvh{mesh};
+        triangles = bvh.TriangleCount();
+    }
+
+    CORRADE_VERIFY(triangles);
+}
+
+CORRADE_TEST_MAIN(EngineBenchmark)
@@ -0,0 +1,403 @@
+// Renders a generated scene without a window and prints frame time percentiles, draw calls and
+// triangle throughput as JSON. Runs on any EGL driver, including Mesa llvmpipe on headless
+// machines:
+//
+//   HeadlessBenchmark --objects 2000 --depth 4 --msaa 8 --size 1280x720 --frames 500
+//
+// Objects go into a SceneStore, as chains of --depth objects with every type of primitive, and
+// are drawn either instanced through SceneStoreRenderer or one by one through RenderQueue like
+// the scene graph primitives of the editor. Only the instanced path culls, so throughput is
+// given in triangles of the whole scene, which both paths have to show, next to the triangles
+// actually drawn.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <Corrade/Utility/Arguments.h>
+
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Platform/WindowlessEglApplication.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+#include <Magnum/SceneGraph/Object.h>
+#include <Magnum/SceneGraph/Scene.h>
+#include <Magnum/Shaders/PhongGL.h>
+
+#include "GpuProfiler.h"
+#include "JobSystem.h"
+#include "MeshLibrary.h"
+#include "RenderQueue.h"
+#include "RenderStats.h"
+#include "RenderTargetPool.h"
+#include "SceneStore.h"
+#include "SceneStoreRenderer.h"
+
+using namespace Magnum;
+using namespace Math::Literals;
+using Object3D = SceneGraph::Object<SceneGraph::MatrixTransformation3D>;
+using Scene3D = SceneGraph::Scene<SceneGraph::MatrixTransformation3D>;
+
+namespace
+{
+
+struct Percentiles
+{
+    double min = 0.0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+Percentiles percentiles(std::vector<double> values)
+{
+    Percentiles result;
+    if (values.empty())
+        return result;
+
+    std::sort(values.begin(), values.end());
+    const auto at = [&values](double fraction) {
+        return values[std::min(values.size() - 1, std::size_t(fraction * values.size()))];
+    };
+
+    for (double value : values)
+        result.mean += value;
+    result.mean /= values.size();
+    result.min = values.front();
+    result.p50 = at(0.5);
+    result.p90 = at(0.9);
+    result.p99 = at(0.99);
+    result.max = values.back();
+    return result;
+}
+
+void printPercentiles(std::FILE *out, const char *name, const Percentiles &values, const char *separator)
+{
+    std::fprintf(out,
+                 "  \"%s\": {\"min\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, "
+                 "\"max\": %.4f}%s\n",
+                 name, values.min, values.mean, values.p50, values.p90, values.p99, values.max, separator);
+}
+
+} // namespace
+
+class HeadlessBenchmark : public Platform::WindowlessApplication
+{
+  public:
+    explicit HeadlessBenchmark(const Arguments &arguments);
+
+    int exec() override;
+
+  private:
+    struct Object
+    {
+        SceneHandle handle;
+        MeshHandle mesh;
+        UnsignedInt material;
+        Matrix4 transformation; // of roots, without the animation
+        bool root;
+    };
+
+    void _createScene();
+    void _drawFrame(unsigned long long frame, RenderTarget &target);
+
+    Utility::Arguments _args;
+    std::size_t _objectsPerType = 0;
+    unsigned int _depth = 1;
+    Int _samples = 0;
+    Vector2i _size;
+    bool _individual = false;
+    bool _animate = true;
+
+    JobSystem _jobs;
+    MeshLibrary _meshLibrary;
+    SceneStore _store;
+    SceneStoreRenderer _storeRenderer;
+    RenderQueue _renderQueue;
+    RenderTargetPool _renderTargets;
+    GpuProfiler _gpuProfiler;
+
+    Shaders::PhongGL _phongShader{NoCreate};
+    Shaders::PhongGL _instancedPhongShader{NoCreate};
+    std::vector<PhongMaterial> _materials;
+    std::vector<Object> _objects;
+
+    Scene3D _scene;
+    Object3D *_cameraObject;
+    SceneGraph::Camera3D *_camera;
+};
+
+HeadlessBenchmark::HeadlessBenchmark(const Arguments &arguments) : Platform::WindowlessApplication{arguments, NoCreate}
+{
+    _args.addOption("objects", "1000")
+        .setHelp("objects", "objects of each primitive type", "N")
+        .addOption("depth", "1")
+        .setHelp("depth", "length of the parent chains objects are arranged in", "N")
+        .addOption("msaa", "8")
+        .setHelp("msaa", "sample count of the scene buffer", "N")
+        .addOption("size", "1280x720")
+        .setHelp("size", "viewport size", "WxH")
+        .addOption("frames", "300")
+        .setHelp("frames", "frames to measure", "N")
+        .addOption("warmup", "30")
+        .setHelp("warmup", "frames to render before measuring", "N")
+        .addOption("path", "instanced")
+        .setHelp("path", "instanced (SceneStoreRenderer) or individual (RenderQueue)", "PATH")
+        .addBooleanOption("static")
+        .setHelp("static", "don't move the objects between frames")
+        .addBooleanOption("multi-draw")
+        .setHelp("multi-draw", "submit individual draws through uniform buffers and multi-draw")
+        .addOption("output", "")
+        .setHelp("output", "write the JSON to a file instead of the standard output", "FILE")
+        .addSkippedPrefix("magnum", "engine-specific options")
+        .setGlobalHelp("Renders a generated scene offscreen and reports frame times as JSON.")
+        .parse(arguments.argc, arguments.argv);
+
+    createContext();
+
+    _objectsPerType = _args.value<std::size_t>("objects");
+    _depth = std::max(_args.value<unsigned int>("depth"), 1u);
+    _samples = _args.value<Int>("msaa");
+    _individual = _args.value("path") == "individual";
+    _animate = !_args.isSet("static");
+    _renderQueue.multiDraw = _args.isSet("multi-draw");
+
+    _size = {1280, 720};
+    std::sscanf(_args.value("size").data(), "%dx%d", &_size.x(), &_size.y());
+    _size = Math::max(_size, Vector2i{1});
+
+    // Same shaders and lighting as the editor
+    _phongShader = Shaders::PhongGL{Shaders::PhongGL::Flag::ObjectId};
+    _phongShader.setAmbientColor(0x747474_rgbf).setShininess(80.0f);
+    _instancedPhongShader = Shaders::PhongGL{Shaders::PhongGL::Flag::InstancedTransformation |
+                                             Shaders::PhongGL::Flag::InstancedObjectId |
+                                             Shaders::PhongGL::Flag::VertexColor};
+    _instancedPhongShader.setAmbientColor(0x111111_rgbf)
+        .setShininess(80.0f)
+        .setLightPositions({Vector4{3.0f, 3.0f, 3.0f, 0.0f}});
+
+    _store.jobs = &_jobs;
+    _createScene();
+}
+
+void HeadlessBenchmark::_createScene()
+{
+    const PrimitiveMeshKey keys[]{PrimitiveMeshKey::Plane(), PrimitiveMeshKey::Cube(), PrimitiveMeshKey::Sphere(),
+                                  PrimitiveMeshKey::Cone(), PrimitiveMeshKey::Capsule()};
+    const std::size_t typeCount = sizeof(keys) / sizeof(keys[0]);
+
+    // Chains start on a square grid around the origin
+    const std::size_t chainsPerType = (_objectsPerType + _depth - 1) / _depth;
+    const std::size_t side = std::size_t(std::ceil(std::sqrt(double(chainsPerType * typeCount))));
+    const Float spacing = 3.0f;
+
+    std::size_t chain = 0;
+    for (std::size_t type = 0; type != typeCount; ++type)
+    {
+        const MeshHandle mesh = _meshLibrary.Get(keys[type]);
+        PhongMaterial material;
+        material.diffuseColor = Color4{Color3::fromHsv({Deg(72.0f * type), 0.6f, 0.9f})};
+        _materials.push_back(material);
+        const UnsignedInt materialId = _store.AddMaterial(material);
+
+        SceneHandle parent;
+        for (std::size_t i = 0; i != _objectsPerType; ++i)
+        {
+            const bool root = i % _depth == 0;
+            Matrix4 transformation;
+            if (root)
+            {
+                const Vector2 grid{Float(chain % side), Float(chain / side)};
+                const Vector2 position = (grid - Vector2{Float(side - 1) * 0.5f}) * spacing;
+                transformation =
+                    Matrix4::translation({position.x(), 0.0f, position.y()}) * Matrix4::scaling(Vector3{0.5f});
+                parent = {};
+                ++chain;
+            }
+            else
+                transformation = Matrix4::translation({0.0f, 1.5f, 0.0f}) * Matrix4::rotationZ(15.0_degf);
+
+            const SceneHandle handle =
+                _store.Create(mesh, materialId, transformation, parent, UnsignedInt(_objects.size() + 1));
+            _objects.push_back({handle, mesh, UnsignedInt(type), transformation, root});
+            parent = handle;
+        }
+    }
+
+    // Looking down at the whole grid
+    const Float extent = Math::max(side * spacing, 1.0f);
+    _cameraObject = new Object3D{&_scene};
+    _cameraObject->setTransformation(Matrix4::lookAt({0.0f, extent * 0.6f, extent * 0.9f}, {}, Vector3::yAxis()));
+    _camera = new SceneGraph::Camera3D{*_cameraObject};
+    _camera->setAspectRatioPolicy(SceneGraph::AspectRatioPolicy::Extend)
+        .setProjectionMatrix(Matrix4::perspectiveProjection(35.0_degf, 1.0f, 0.01f, extent * 4.0f))
+        .setViewport(_size);
+}
+
+void HeadlessBenchmark::_drawFrame(unsigned long long frame, RenderTarget &target)
+{
+    // Every root turns a little each frame, which moves the whole chain
+    if (_animate)
+    {
+        const Matrix4 rotation = Matrix4::rotationY(Deg(Float(frame)));
+        for (const Object &object : _objects)
+            if (object.root)
+                _store.SetTransformation(object.handle, object.transformation * rotation);
+    }
+
+    GL::Framebuffer &framebuffer = target.framebufferMSAA;
+    framebuffer.mapForDraw({{Shaders::PhongGL::ColorOutput, GL::Framebuffer::ColorAttachment{0}},
+                            {Shaders::PhongGL::ObjectIdOutput, GL::Framebuffer::ColorAttachment{1}}});
+    framebuffer.clearColor(0, Vector4{0.15f, 0.15f, 0.15f, 1.0f});
+    framebuffer.clearColor(1, Vector4ui{0});
+    framebuffer.clear(GL::FramebufferClear::Depth | GL::FramebufferClear::Stencil).bind();
+
+    GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
+    GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
+
+    {
+        GpuScope scope{_gpuProfiler, "Scene pass"};
+        _cameraObject->setClean();
+        if (_individual)
+        {
+            _store.Update();
+            const Matrix4 cameraMatrix = _camera->cameraMatrix();
+            for (std::size_t i = 0; i != _objects.size(); ++i)
+            {
+                const Object &object = _objects[i];
+                _renderQueue.Submit(_phongShader, object.mesh->mesh, _materials[object.material],
+                                    cameraMatrix * _store.World(object.handle), UnsignedInt(i + 1));
+            }
+            _renderQueue.Flush(*_camera);
+        }
+        else
+        {
+            _storeRenderer.Prepare(_store, _camera->projectionMatrix() * _camera->cameraMatrix());
+            _storeRenderer.Present();
+            _storeRenderer.Draw(_instancedPhongShader, *_camera);
+        }
+    }
+
+    {
+        GpuScope scope{_gpuProfiler, "Resolve blit"};
+        framebuffer.mapForRead(GL::Framebuffer::ColorAttachment{0});
+        GL::AbstractFramebuffer::blit(framebuffer, target.framebufferProxy, framebuffer.viewport(),
+                                      GL::FramebufferBlit::Color);
+    }
+}
+
+int HeadlessBenchmark::exec()
+{
+    using Clock = std::chrono::steady_clock;
+
+    const unsigned int warmup = _args.value<unsigned int>("warmup");
+    const unsigned int frames = std::max(_args.value<unsigned int>("frames"), 1u);
+
+    std::vector<double> cpuMilliseconds;
+    std::vector<double> frameMilliseconds;
+    std::vector<double> gpuMilliseconds;
+    std::size_t drawCalls = 0;
+    std::size_t trianglesDrawn = 0;
+    double totalSeconds = 0.0;
+
+    // The same for both paths, unlike what's drawn, which the instanced path culls
+    std::size_t sceneTriangles = 0;
+    for (const Object &object : _objects)
+        sceneTriangles += object.mesh->triangles;
+
+    // The profiler only keeps the last HistoryCapacity frames, so they're collected as they
+    // resolve
+    unsigned long long lastGpuFrame = warmup;
+    const auto collectGpuTimings = [&] {
+        for (const GpuFrameTiming &timing : _gpuProfiler.History())
+        {
+            if (timing.index <= lastGpuFrame)
+                continue;
+            gpuMilliseconds.push_back(timing.milliseconds);
+            lastGpuFrame = timing.index;
+        }
+    };
+
+    // Mesh uploads of the setup don't count into the first frame
+    RenderStats &renderStats = RenderStats::Shared();
+    renderStats.BeginFrame();
+
+    for (unsigned long long frame = 1; frame <= warmup + frames; ++frame)
+    {
+        const Clock::time_point start = Clock::now();
+        _jobs.BeginFrame();
+        _renderTargets.BeginFrame();
+        _gpuProfiler.BeginFrame(frame);
+        collectGpuTimings();
+        _drawFrame(frame, _renderTargets.Acquire(_size, GL::RenderbufferFormat::RGBA8, _samples));
+        const Clock::time_point submitted = Clock::now();
+
+        // There's no swap to pace the frames, wait for the GPU instead so its time counts
+        GL::Renderer::finish();
+        const Clock::time_point finished = Clock::now();
+        renderStats.BeginFrame();
+
+        if (frame <= warmup)
+            continue;
+
+        cpuMilliseconds.push_back(std::chrono::duration<double, std::milli>(submitted - start).count());
+        frameMilliseconds.push_back(std::chrono::duration<double, std::milli>(finished - start).count());
+        totalSeconds += std::chrono::duration<double>(finished - start).count();
+        drawCalls += renderStats.Statistics().drawCalls;
+        trianglesDrawn += renderStats.Statistics().triangles;
+    }
+
+    // Everything is finished by now, one more frame collects the remaining query results
+    _gpuProfiler.BeginFrame(warmup + frames + 1);
+    collectGpuTimings();
+
+    const std::string output = _args.value("output");
+    std::FILE *out = output.empty() ? stdout : std::fopen(output.data(), "w");
+    if (!out)
+    {
+        Error{} << "Can't open" << output.data();
+        return 1;
+    }
+
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"renderer\": \"%s\",\n", GL::Context::current().rendererString().data());
+    std::fprintf(out, "  \"version\": \"%s\",\n", GL::Context::current().versionString().data());
+    std::fprintf(out,
+                 "  \"config\": {\"objectsPerType\": %zu, \"depth\": %u, \"msaa\": %d, \"width\": %d, "
+                 "\"height\": %d, \"frames\": %u, \"warmup\": %u, \"path\": \"%s\", \"multiDraw\": %s, "
+                 "\"animated\": %s},\n",
+                 _objectsPerType, _depth, _samples, _size.x(), _size.y(), frames, warmup,
+                 _individual ? "individual" : "instanced", _renderQueue.multiDraw ? "true" : "false",
+                 _animate ? "true" : "false");
+    std::fprintf(out, "  \"objects\": %zu,\n", _objects.size());
+    printPercentiles(out, "frameMilliseconds", percentiles(frameMilliseconds), ",");
+    printPercentiles(out, "cpuMilliseconds", percentiles(cpuMilliseconds), ",");
+    if (_gpuProfiler.Statistics().supported)
+    {
+        // Frames whose queries weren't ready in time are missing
+        std::fprintf(out, "  \"gpuFrames\": %zu,\n", gpuMilliseconds.size());
+        printPercentiles(out, "gpuMilliseconds", percentiles(gpuMilliseconds), ",");
+    }
+    std::fprintf(out, "  \"drawCallsPerFrame\": %.1f,\n", double(drawCalls) / frames);
+    std::fprintf(out, "  \"sceneTriangles\": %zu,\n", sceneTriangles);
+    std::fprintf(out, "  \"trianglesDrawnPerFrame\": %.1f,\n", double(trianglesDrawn) / frames);
+    std::fprintf(out, "  \"sceneTrianglesPerSecond\": %.1f\n",
+                 totalSeconds > 0.0 ? sceneTriangles * frames / totalSeconds : 0.0);
+    std::fprintf(out, "}\n");
+
+    if (out != stdout)
+        std::fclose(out);
+    return 0;
+}
+
+MAGNUM_WINDOWLESSAPPLICATION_MAIN(HeadlessBenchmark)
@@ -8,6 +8,9 @@
 #include <Magnum/Shaders/PhongGL.h>
 #include <Magnum/Shaders/VertexColorGL.h>
 
+#include "RenderQueue.h"
+#include "RenderStats.h"
+
 namespace Magnum
 {
 
@@ -19,28 +22,24 @@ typedef SceneGraph::Scene<SceneGraph::MatrixTransformation3D> Scene3D;
 class ColoredDrawable : public SceneGraph::Drawable3D
 {
   public:
-    explicit ColoredDrawable(Object3D &object, Shaders::PhongGL &shader, GL::Mesh &mesh, const Color4 &color,
-                             SceneGraph::DrawableGroup3D &group)
-        : SceneGraph::Drawable3D{object, &group}, _shader(shader), _mesh(mesh), _color{color}
+    explicit ColoredDrawable(Object3D &object, RenderQueue &queue, Shaders::PhongGL &shader, GL::Mesh &mesh,
+                             const Color4 &color, SceneGraph::DrawableGroup3D &group)
+        : SceneGraph::Drawable3D{object, &group}, _queue(queue), _shader(shader), _mesh(mesh)
     {
+        _material.diffuseColor = color;
     }
 
   private:
-    void draw(const Matrix4 &transformationMatrix, SceneGraph::Camera3D &camera) override
+    void draw(const Matrix4 &transformationMatrix, SceneGraph::Camera3D &) override
     {
-        _shader.setDiffuseColor(_color)
-            .setAmbientColor(0x111111_rgbf)
-            .setShininess(80.0f)
-            .setLightPositions({Vector4{3.0f, 3.0f, 3.0f, 0.0f}})
-            .setTransformationMatrix(transformationMatrix)
-            .setNormalMatrix(transformationMatrix.normalMatrix())
-            .setProjectionMatrix(camera.projectionMatrix())
-            .draw(_mesh);
+        // Not pickable, drawn with object ID 0
+        _queue.Submit(_shader, _mesh, _material, transformationMatrix);
     }
 
+    RenderQueue &_queue;
     Shaders::PhongGL &_shader;
     GL::Mesh &_mesh;
-    Color4 _color;
+    PhongMaterial _material;
 };
 
 class VertexColorDrawable : public SceneGraph::Drawable3D
@@ -55,6 +54,10 @@ class VertexColorDrawable : public SceneGraph::Drawable3D
     void draw(const Matrix4 &transformation, SceneGraph::Camera3D &camera)
     {
         _shader.setTransformationProjectionMatrix(camera.projectionMatrix() * transformation).draw(_mesh);
+
+        RenderStats &renderStats = RenderStats::Shared();
+        renderStats.UniformsSet();
+        renderStats.Draw(&_shader, _mesh);
     }
 
   private:
@@ -76,6 +79,10 @@ class FlatDrawable : public SceneGraph::Drawable3D
         _shader.setColor(0x747474_rgbf)
             .setTransformationProjectionMatrix(camera.projectionMatrix() * transformation)
             .draw(_mesh);
+
+        RenderStats &renderStats = RenderStats::Shared();
+        renderStats.UniformsSet(2);
+        renderStats.Draw(&_shader, _mesh);
     }
 
   private:
@@ -144,7 +144,9 @@ void update()
         }
     }
 
-    // Update mouse move
+    // Update mouse move, there's no cursor without a window
+    if (!_window)
+        return;
     double x, y;
     glfwGetCursorPos(_window, &x, &y);
     Input::updateMouseMove(Magnum::Vector2i{(int)x, (int)y});
@@ -0,0 +1,280 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "TraceRecorder.h"
+
+struct JobHandle::Job
+{
+    std::function<void()> function;
+
+    // Unfinished dependencies, plus one held by Submit() while it registers them
+    std::atomic<int> pending{1};
+    std::atomic<bool> done{false};
+
+    // Jobs depending on this one, guarded by the mutex together with done
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Job>> continuations;
+};
+
+namespace
+{
+
+// Queue of the current thread, only set on workers
+thread_local const JobSystem *workerSystem = nullptr;
+thread_local std::size_t workerQueue = 0;
+
+// Jobs run from within a job while it waits count towards the busy time of the outer one
+thread_local int jobDepth = 0;
+
+long long now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+bool JobHandle::Done() const
+{
+    return !_job || _job->done.load(std::memory_order_acquire);
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    if (!workerCount)
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    for (unsigned int i = 0; i != workerCount + 1; ++i)
+        _queues.push_back(std::make_unique<Queue>());
+
+    _stats.workers.resize(_queues.size());
+    _frameStart = now();
+
+    for (unsigned int i = 0; i != workerCount; ++i)
+        _workers.emplace_back([this, i] { _workerLoop(i + 1); });
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock{_sleepMutex};
+        _stop = true;
+    }
+    _wake.notify_all();
+
+    for (std::thread &worker : _workers)
+        worker.join();
+}
+
+JobHandle JobSystem::Submit(std::function<void()> function, std::initializer_list<JobHandle> dependencies)
+{
+    auto job = std::make_shared<Job>();
+    job->function = std::move(function);
+
+    if (deterministic)
+    {
+        for (const JobHandle &dependency : dependencies)
+            Wait(dependency);
+
+        _execute(*job, _queues[_queueIndex()]->counters);
+        _finish(*job);
+        return JobHandle{std::move(job)};
+    }
+
+    for (const JobHandle &dependency : dependencies)
+    {
+        if (!dependency._job)
+            continue;
+
+        Job &before = *dependency._job;
+        std::lock_guard<std::mutex> lock{before.mutex};
+        if (before.done.load(std::memory_order_relaxed))
+            continue;
+
+        job->pending.fetch_add(1, std::memory_order_relaxed);
+        before.continuations.push_back(job);
+    }
+
+    JobHandle handle{job};
+    if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        _schedule(std::move(job));
+    return handle;
+}
+
+void JobSystem::Wait(const JobHandle &handle)
+{
+    const std::size_t index = _queueIndex();
+    while (!handle.Done())
+    {
+        if (!_runOne(index))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::BeginFrame()
+{
+    const long long frameEnd = now();
+    _stats.frameMilliseconds = (frameEnd - _frameStart) * 1.0e-6;
+    _frameStart = frameEnd;
+
+    _stats.jobs = 0;
+    for (std::size_t i = 0; i != _queues.size(); ++i)
+    {
+        Counters &counters = _queues[i]->counters;
+        WorkerStats &worker = _stats.workers[i];
+        worker.jobs = counters.jobs.exchange(0, std::memory_order_relaxed);
+        worker.steals = counters.steals.exchange(0, std::memory_order_relaxed);
+        worker.busyMilliseconds = counters.busyNanoseconds.exchange(0, std::memory_order_relaxed) * 1.0e-6;
+        worker.utilization =
+            _stats.frameMilliseconds > 0.0 ? float(std::min(worker.busyMilliseconds / _stats.frameMilliseconds, 1.0))
+                                           : 0.0f;
+        _stats.jobs += worker.jobs;
+    }
+}
+
+void JobSystem::_parallelFor(std::size_t count, std::size_t grainSize,
+                             const std::function<void(std::size_t, std::size_t)> &function)
+{
+    grainSize = std::max<std::size_t>(grainSize, 1);
+
+    // The ranges are the same either way, so only the order they run in differs
+    if (deterministic || _workers.empty() || count <= grainSize)
+    {
+        for (std::size_t begin = 0; begin < count; begin += grainSize)
+            function(begin, std::min(begin + grainSize, count));
+        return;
+    }
+
+    std::vector<JobHandle> ranges;
+    ranges.reserve((count + grainSize - 1) / grainSize);
+    for (std::size_t begin = 0; begin < count; begin += grainSize)
+    {
+        const std::size_t end = std::min(begin + grainSize, count);
+        ranges.push_back(Submit([&function, begin, end] { function(begin, end); }));
+    }
+
+    for (const JobHandle &range : ranges)
+        Wait(range);
+}
+
+void JobSystem::_workerLoop(std::size_t index)
+{
+    workerSystem = this;
+    workerQueue = index;
+    TraceRecorder::Shared().NameThread("Worker " + std::to_string(index));
+
+    for (;;)
+    {
+        if (_runOne(index))
+            continue;
+
+        std::unique_lock<std::mutex> lock{_sleepMutex};
+        _wake.wait(lock, [this] { return _stop || _queued.load(std::memory_order_acquire); });
+        if (_stop && !_queued.load(std::memory_order_acquire))
+            return;
+    }
+}
+
+void JobSystem::_schedule(std::shared_ptr<Job> job)
+{
+    Queue &queue = *_queues[_queueIndex()];
+    {
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        queue.jobs.push_back(std::move(job));
+    }
+    _queued.fetch_add(1, std::memory_order_release);
+
+    // Taking the mutex orders this with a worker checking for work before it goes to sleep
+    {
+        std::lock_guard<std::mutex> lock{_sleepMutex};
+    }
+    _wake.notify_one();
+}
+
+bool JobSystem::_runOne(std::size_t index)
+{
+    std::shared_ptr<Job> job = _take(index);
+    if (!job)
+        return false;
+
+    _execute(*job, _queues[index]->counters);
+    _finish(*job);
+    return true;
+}
+
+std::shared_ptr<JobSystem::Job> JobSystem::_take(std::size_t index)
+{
+    if (!_queued.load(std::memory_order_acquire))
+        return nullptr;
+
+    // Newest job of our own first, it's the most likely to still be in cache
+    {
+        Queue &own = *_queues[index];
+        std::lock_guard<std::mutex> lock{own.mutex};
+        if (!own.jobs.empty())
+        {
+            std::shared_ptr<Job> job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    // Then the oldest one of someone else, which tends to be the largest piece of work left
+    for (std::size_t i = 1; i != _queues.size(); ++i)
+    {
+        Queue &victim = *_queues[(index + i) % _queues.size()];
+        std::lock_guard<std::mutex> lock{victim.mutex};
+        if (victim.jobs.empty())
+            continue;
+
+        std::shared_ptr<Job> job = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        _queued.fetch_sub(1, std::memory_order_relaxed);
+        _queues[index]->counters.steals.fetch_add(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    return nullptr;
+}
+
+void JobSystem::_execute(Job &job, Counters &counters)
+{
+    const long long start = now();
+    ++jobDepth;
+    job.function();
+    job.function = nullptr;
+    const long long end = now();
+    if (!--jobDepth)
+        counters.busyNanoseconds.fetch_add(end - start, std::memory_order_relaxed);
+
+    TraceRecorder &trace = TraceRecorder::Shared();
+    if (trace.Recording())
+        trace.Complete("Job", nullptr, start, end);
+    counters.jobs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobSystem::_finish(Job &job)
+{
+    std::vector<std::shared_ptr<Job>> continuations;
+    {
+        std::lock_guard<std::mutex> lock{job.mutex};
+        job.done.store(true, std::memory_order_release);
+        continuations.swap(job.continuations);
+    }
+
+    for (std::shared_ptr<Job> &continuation : continuations)
+    {
+        if (continuation->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            _schedule(std::move(continuation));
+    }
+}
+
+std::size_t JobSystem::_queueIndex() const
+{
+    return workerSystem == this ? workerQueue : 0;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Refers to a submitted job, for waiting on it or making other jobs depend on it. A
+// default-constructed handle counts as a job that already finished.
+class JobHandle
+{
+  public:
+    JobHandle() = default;
+
+    bool Done() const;
+
+  private:
+    friend JobSystem;
+
+    struct Job;
+
+    explicit JobHandle(std::shared_ptr<Job> job) : _job{std::move(job)}
+    {
+    }
+
+    std::shared_ptr<Job> _job;
+};
+
+// Work-stealing thread pool. Every worker has its own deque: it pushes and pops jobs at the back
+// and, once out of work, steals the oldest job from the front of another worker's deque. Threads
+// that aren't workers, such as the main thread, submit into a deque of their own and run jobs
+// while they wait, so blocking on a job never leaves a core idle.
+//
+// With deterministic set, jobs run on the submitting thread in submission order and ParallelFor()
+// runs its ranges in order, which makes races reproducible and stepping through jobs easy.
+class JobSystem
+{
+  public:
+    struct WorkerStats
+    {
+        std::size_t jobs = 0;
+        std::size_t steals = 0;
+        double busyMilliseconds = 0.0;
+        float utilization = 0.0f; // busy fraction of the frame
+    };
+
+    struct Stats
+    {
+        // During the last full frame. The first entry is the threads outside of the pool.
+        std::vector<WorkerStats> workers;
+        std::size_t jobs = 0;
+        double frameMilliseconds = 0.0;
+    };
+
+    // Zero picks one worker less than there are hardware threads, leaving a core for the main
+    // thread
+    explicit JobSystem(unsigned int workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // The job starts once all of the dependencies finished
+    JobHandle Submit(std::function<void()> function, std::initializer_list<JobHandle> dependencies = {});
+
+    // Runs jobs until the one given finished
+    void Wait(const JobHandle &handle);
+
+    // Calls function(begin, end) for consecutive ranges of at most grainSize indices covering
+    // [0, count) and returns once all of them finished. The calling thread takes part.
+    template <class F> void ParallelFor(std::size_t count, std::size_t grainSize, F &&function)
+    {
+        _parallelFor(count, grainSize, std::function<void(std::size_t, std::size_t)>{std::forward<F>(function)});
+    }
+
+    // Workers plus the calling thread
+    std::size_t Concurrency() const
+    {
+        return _workers.size() + 1;
+    }
+
+    // Publishes the counters of the frame that just ended
+    void BeginFrame();
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    // Read by ParallelFor() on workers, so it may change while jobs are in flight
+    std::atomic<bool> deterministic{false};
+
+  private:
+    using Job = JobHandle::Job;
+
+    // Counters are written by their own thread only and read when a frame ends
+    struct Counters
+    {
+        std::atomic<std::size_t> jobs{0};
+        std::atomic<std::size_t> steals{0};
+        std::atomic<long long> busyNanoseconds{0};
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<Job>> jobs;
+        Counters counters;
+    };
+
+    void _parallelFor(std::size_t count, std::size_t grainSize,
+                      const std::function<void(std::size_t, std::size_t)> &function);
+    void _workerLoop(std::size_t index);
+    void _schedule(std::shared_ptr<Job> job);
+    bool _runOne(std::size_t index);
+    std::shared_ptr<Job> _take(std::size_t index);
+    void _execute(Job &job, Counters &counters);
+    void _finish(Job &job);
+    std::size_t _queueIndex() const;
+
+    // Queue 0 is shared by the threads outside of the pool, worker i owns queue i + 1
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+    std::atomic<std::size_t> _queued{0};
+    bool _stop = false;
+
+    long long _frameStart = 0;
+    Stats _stats;
+};
@@ -14,20 +14,58 @@ class CameraControllerLayer : public Layer
     void OnAttach() override
     {
         app = Application::singleton();
+        _position = _previousPosition = _rendered = app->mainCam->transformation().translation();
     }
 
     void OnDetach() override
     {
     }
 
+    // Moving with keys is simulated at the fixed rate, so the speed doesn't depend on the frame
+    // rate
+    virtual void OnFixedUpdate() override
+    {
+        // Someone else moved the camera, continue from there
+        const Magnum::Vector3 current = app->mainCam->transformation().translation();
+        if (current != _rendered)
+            _position = _rendered = current;
+
+        _previousPosition = _position;
+        if (!_flying())
+            return;
+
+        float moveSpeed = 6.0f; // units per second
+        if (Input::GetKey(KeyCode::LeftShift))
+            moveSpeed *= 2;
+
+        const Magnum::Matrix4 &transformation = app->mainCam->transformation();
+        Magnum::Vector3 direction;
+        if (Input::GetKey(KeyCode::W))
+            direction -= transformation.backward();
+        if (Input::GetKey(KeyCode::S))
+            direction += transformation.backward();
+        if (Input::GetKey(KeyCode::A))
+            direction -= transformation.right();
+        if (Input::GetKey(KeyCode::D))
+            direction += transformation.right();
+        if (Input::GetKey(KeyCode::E))
+            direction += transformation.up();
+        if (Input::GetKey(KeyCode::Q))
+            direction -= transformation.up();
+
+        _position += direction * moveSpeed * app->clock.FixedDeltaSeconds();
+    }
+
     virtual void OnUpdate() override
     {
         // Do some processing
-        float moveSpeed = 0.1f;
         auto mouseSensitivity = 0.002_radf;
 
-        if (app->usingViewport && Input::GetMouseButton(1))
+        if (_flying())
         {
+            // Keys held down don't send events, the camera keeps moving without them
+            app->RequestFrame();
+
             // Update camera rotations
             Magnum::Vector3 _rotationPoint = app->mainCam->transformation().translation();
 
@@ -38,29 +76,18 @@ class CameraControllerLayer : public Layer
 
             // Rotation about local
             app->mainCam->transformLocal(Magnum::Matrix4::rotationX(-mouseSensitivity * Input::GetMouseDelta().y()));
+        }
 
-            // Move camera with keys
-            if (Input::GetKey(KeyCode::LeftShift))
-                moveSpeed *= 2;
-
-            if (Input::GetKey(KeyCode::W))
-                app->mainCam->translateLocal(VectorForward * -moveSpeed);
-
-            if (Input::GetKey(KeyCode::A))
-                app->mainCam->translateLocal(VectorLeft * moveSpeed);
-
-            if (Input::GetKey(KeyCode::S))
-                app->mainCam->translateLocal(VectorBackward * -moveSpeed);
-
-            if (Input::GetKey(KeyCode::D))
-                app->mainCam->translateLocal(VectorRight * moveSpeed);
-
-            if (Input::GetKey(KeyCode::E))
-                app->mainCam->translateLocal(VectorUp * moveSpeed);
-
-            if (Input::GetKey(KeyCode::Q))
-                app->mainCam->translateLocal(VectorDown * moveSpeed);
+        // Rendered between the last two simulated positions
+        _rendered = Magnum::Math::lerp(_previousPosition, _position, app->clock.Alpha());
+        Magnum::Matrix4 transformation = app->mainCam->transformation();
+        if (transformation.translation() != _rendered)
+        {
+            transformation.translation() = _rendered;
+            app->mainCam->setTransformation(transformation);
         }
+        if (_previousPosition != _position)
+            app->RequestFrame();
     }
 
     virtual void OnGuiRender() override
@@ -69,5 +96,13 @@ class CameraControllerLayer : public Layer
     }
 
   private:
+    bool _flying() const
+    {
+        return app->usingViewport && Input::GetMouseButton(1);
+    }
+
     Application *app;
+    Magnum::Vector3 _previousPosition;
+    Magnum::Vector3 _position;
+    Magnum::Vector3 _rendered; // where OnUpdate() put the camera
 };
\ No newline at end of file
@@ -22,11 +22,11 @@ class GuiLayer : public Layer
     {
         toolbar.Draw();
 
-        if (app->selectedObject != nullptr)
+        if (Object3D *selected = app->SelectedObject())
         {
             ImGui::Begin("Transform");
 
-            Magnum::Matrix4 matrix = app->selectedObject->transformation();
+            Magnum::Matrix4 matrix = selected->transformation();
 
             if (ImGui::IsKeyPressed(90))
                 app->mCurrentGizmoOperation = ImGuizmo::TRANSLATE;
@@ -44,10 +44,9 @@ class GuiLayer : public Layer
                 app->mCurrentGizmoOperation = ImGuizmo::SCALE;
             float matrixTranslation[3], matrixRotation[3], matrixScale[3];
             ImGuizmo::DecomposeMatrixToComponents(matrix.data(), matrixTranslation, matrixRotation, matrixScale);
-            ImGui::InputFloat3("Translation", matrixTranslation, "%.2f");
-            ImGui::InputFloat3("Rotation", matrixRotation, "%.2f");
-            ImGui::InputFloat3("Scale", matrixScale, "%.2f");
-            ImGuizmo::RecomposeMatrixFromComponents(matrixTranslation, matrixRotation, matrixScale, matrix.data());
+            bool edited = ImGui::InputFloat3("Translation", matrixTranslation, "%.2f");
+            edited |= ImGui::InputFloat3("Rotation", matrixRotation, "%.2f");
+            edited |= ImGui::InputFloat3("Scale", matrixScale, "%.2f");
 
             if (app->mCurrentGizmoOperation != ImGuizmo::SCALE)
             {
@@ -58,7 +57,14 @@ class GuiLayer : public Layer
                     app->mCurrentGizmoMode = ImGuizmo::WORLD;
             }
 
-            app->selectedObject->setTransformation(matrix);
+            // Decomposing and recomposing isn't exact, so an untouched matrix is left alone instead of
+            // dirtying the object every frame
+            if (edited)
+            {
+                ImGuizmo::RecomposeMatrixFromComponents(matrixTranslation, matrixRotation, matrixScale,
+                                                        matrix.data());
+                TransformCache::SetTransformation(*selected, matrix);
+            }
 
             ImGui::End();
         }
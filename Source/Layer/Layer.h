@@ -11,17 +11,26 @@ The result is going to be not exactly the same, but the idea is
 class Layer
 {
   public:
-    Layer(const char *name = "Layer")
+    Layer(const char *name = "Layer") : mName{name}
     {
     }
     virtual ~Layer() = default;
 
+    const char *Name() const
+    {
+        return mName;
+    }
+
     virtual void OnAttach()
     {
     }
     virtual void OnDetach()
     {
     }
+    // Called at the clock's fixed rate, zero or more times before each OnUpdate()
+    virtual void OnFixedUpdate()
+    {
+    }
     virtual void OnUpdate()
     {
     }
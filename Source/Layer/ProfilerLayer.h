@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Application.h"
+#include "Layer.h"
+
+// Timeline of the frames recorded by the application's CPU profiler, plus min/avg/p99 of every
+// scope over all of them
+class ProfilerLayer : public Layer
+{
+  public:
+    ProfilerLayer(const char *name = "ProfilerLayer") : Layer{name}
+    {
+    }
+
+    void OnAttach() override
+    {
+        app = Application::singleton();
+    }
+
+    virtual void OnGuiRender() override
+    {
+        if (!ImGui::Begin("Profiler"))
+        {
+            ImGui::End();
+            return;
+        }
+
+        CpuProfiler &profiler = app->profiler;
+        ImGui::Checkbox("Pause", &profiler.paused);
+        ImGui::SameLine();
+        _drawTraceControls();
+
+        // Oldest first, so the newest frame is on the right
+        const std::size_t count = profiler.FrameCount();
+        _frames.resize(count);
+        _frameMilliseconds.clear();
+        for (std::size_t age = count; age-- != 0;)
+        {
+            ProfileFrame &frame = _frames[count - 1 - age];
+            if (!profiler.CopyFrame(age, frame))
+                frame = {};
+            _frameMilliseconds.push_back((frame.end - frame.start) * 1.0e-6f);
+        }
+
+        if (count)
+        {
+            ImGui::SameLine();
+            _selectedAge = std::min(_selectedAge, int(count) - 1);
+            ImGui::SliderInt("Frames ago", &_selectedAge, 0, int(count) - 1);
+
+            ImGui::PlotHistogram("##Frames", _frameMilliseconds.data(), int(_frameMilliseconds.size()), 0,
+                                 "Frame time (ms)", 0.0f, FLT_MAX, {-1.0f, 60.0f});
+            _drawTimeline(_frames[count - 1 - _selectedAge]);
+            _drawBreakdown();
+        }
+
+        ImGui::End();
+    }
+
+  private:
+    // Records everything from all threads and the GPU until saved, for chrome://tracing or Perfetto
+    void _drawTraceControls()
+    {
+        TraceRecorder &trace = TraceRecorder::Shared();
+        if (!trace.Recording())
+        {
+            if (ImGui::Button("Record trace"))
+                trace.Start();
+            if (_traceStatus)
+            {
+                ImGui::SameLine();
+                ImGui::TextUnformatted(_traceStatus);
+            }
+            return;
+        }
+
+        if (ImGui::Button("Save trace"))
+        {
+            trace.Stop();
+            _traceStatus = trace.Write("trace.json") ? "Saved trace.json" : "Couldn't write trace.json";
+        }
+        ImGui::SameLine();
+        ImGui::Text("%zu events", trace.EventCount());
+        if (trace.DroppedCount())
+        {
+            ImGui::SameLine();
+            ImGui::Text("(%zu dropped)", trace.DroppedCount());
+        }
+    }
+
+    void _drawTimeline(const ProfileFrame &frame)
+    {
+        const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        unsigned int depth = 0;
+        for (const ProfileSample &sample : frame.samples)
+            depth = std::max(depth, sample.depth + 1);
+
+        const double duration = std::max<double>(frame.end - frame.start, 1.0);
+        ImGui::Text("Frame %llu: %.3f ms", frame.index, duration * 1.0e-6);
+
+        const ImVec2 origin = ImGui::GetCursorScreenPos();
+        const float width = ImGui::GetContentRegionAvail().x;
+        ImGui::InvisibleButton("##Timeline", {std::max(width, 1.0f), std::max(depth * rowHeight, 1.0f)});
+
+        ImDrawList *drawList = ImGui::GetWindowDrawList();
+        const ImVec2 mouse = ImGui::GetMousePos();
+        for (const ProfileSample &sample : frame.samples)
+        {
+            const ImVec2 min{origin.x + float((sample.start - frame.start) / duration) * width,
+                             origin.y + sample.depth * rowHeight};
+            const ImVec2 max{std::max(origin.x + float((sample.end - frame.start) / duration) * width, min.x + 1.0f),
+                             min.y + rowHeight - 1.0f};
+
+            // Same scope, same color across frames
+            const std::size_t hash = std::hash<const char *>{}(sample.name) ^ std::hash<const char *>{}(sample.owner);
+            const ImU32 color = IM_COL32(80 + hash % 150, 80 + (hash >> 8) % 150, 80 + (hash >> 16) % 150, 255);
+            drawList->AddRectFilled(min, max, color);
+
+            char label[128];
+            _label(sample, label, sizeof(label));
+            if (ImGui::CalcTextSize(label).x < max.x - min.x)
+                drawList->AddText({min.x + 2.0f, min.y}, IM_COL32_WHITE, label);
+
+            if (ImGui::IsItemHovered() && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y)
+                ImGui::SetTooltip("%s: %.3f ms", label, (sample.end - sample.start) * 1.0e-6);
+        }
+    }
+
+    void _drawBreakdown()
+    {
+        // Time of every scope summed up per frame, frames it didn't run in don't count
+        std::map<std::pair<const char *, const char *>, std::vector<float>> scopes;
+        for (const ProfileFrame &frame : _frames)
+        {
+            std::map<std::pair<const char *, const char *>, float> totals;
+            for (const ProfileSample &sample : frame.samples)
+                totals[{sample.owner, sample.name}] += (sample.end - sample.start) * 1.0e-6f;
+            for (const auto &total : totals)
+                scopes[total.first].push_back(total.second);
+        }
+
+        if (!ImGui::BeginTable("Breakdown", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+            return;
+
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("Min (ms)");
+        ImGui::TableSetupColumn("Avg (ms)");
+        ImGui::TableSetupColumn("p99 (ms)");
+        ImGui::TableHeadersRow();
+
+        for (auto &scope : scopes)
+        {
+            std::vector<float> &times = scope.second;
+            std::sort(times.begin(), times.end());
+            float sum = 0.0f;
+            for (float time : times)
+                sum += time;
+
+            ProfileSample sample;
+            sample.owner = scope.first.first;
+            sample.name = scope.first.second;
+            char label[128];
+            _label(sample, label, sizeof(label));
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(label);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", times.front());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", sum / times.size());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", times[std::min(times.size() - 1, times.size() * 99 / 100)]);
+        }
+
+        ImGui::EndTable();
+    }
+
+    static void _label(const ProfileSample &sample, char *label, std::size_t size)
+    {
+        if (sample.owner)
+            std::snprintf(label, size, "%s::%s", sample.owner, sample.name);
+        else
+            std::snprintf(label, size, "%s", sample.name);
+    }
+
+    Application *app;
+    std::vector<ProfileFrame> _frames;
+    std::vector<float> _frameMilliseconds;
+    int _selectedAge = 0;
+    const char *_traceStatus = nullptr;
+};
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+
+#include "Application.h"
+#include "Layer.h"
+#include "PropagationBenchmark.h"
+#include "RenderStats.h"
+
+class StatsLayer : public Layer
+{
+  public:
+    StatsLayer(const char *name = "StatsLayer") : Layer{name}
+    {
+    }
+
+    void OnAttach() override
+    {
+        app = Application::singleton();
+    }
+
+    virtual void OnGuiRender() override
+    {
+        ImGui::Begin("Stats");
+
+        if (ImGui::CollapsingHeader("Rendering", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            const RenderStats::Stats &render = RenderStats::Shared().Statistics();
+            ImGui::Text("Draw calls: %zu, instances: %zu", render.drawCalls, render.instances);
+            ImGui::Text("Triangles: %zu, vertices: %zu", render.triangles, render.vertices);
+            ImGui::Text("Shader binds: %zu, uniform sets: %zu, texture binds: %zu", render.shaderBinds,
+                        render.uniformSets, render.textureBinds);
+            ImGui::Text("Uploaded: %.1f KiB", render.uploadedBytes / 1024.0f);
+            ImGui::Text("Framebuffers created: %zu, state changes: %zu", render.framebuffersCreated,
+                        render.stateChanges);
+        }
+
+        if (ImGui::CollapsingHeader("Meshes", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            const MeshLibrary::Stats &meshes = app->meshLibrary.Statistics();
+            ImGui::Text("Live meshes: %zu", meshes.liveMeshes);
+            ImGui::Text("Library hits: %zu, misses: %zu", meshes.hits, meshes.misses);
+            ImGui::Text("GPU memory: %.1f KiB (peak %.1f KiB)", meshes.gpuBytes / 1024.0f,
+                        meshes.peakGpuBytes / 1024.0f);
+        }
+
+        if (ImGui::CollapsingHeader("Frame pacing", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            FramePacer &pacer = app->pacer;
+            ImGui::Checkbox("Render on demand", &pacer.onDemand);
+            ImGui::SliderFloat("FPS cap", &pacer.maxFramesPerSecond, 0.0f, 240.0f, "%.0f");
+            ImGui::SliderFloat("Idle FPS", &pacer.idleFramesPerSecond, 0.0f, 60.0f, "%.0f");
+
+            const FramePacer::Stats &frames = pacer.Statistics();
+            ImGui::Text("%.1f FPS, rendered: %zu, skipped: %zu", frames.framesPerSecond, frames.renderedFrames,
+                        frames.skippedFrames);
+
+            const FrameClock::Stats &clock = app->clock.Statistics();
+            ImGui::SliderFloat("Fixed rate", &app->clock.fixedUpdatesPerSecond, 10.0f, 240.0f, "%.0f Hz");
+            ImGui::Text("Delta: %.2f ms, fixed steps: %u (%zu dropped)", app->clock.DeltaSeconds() * 1000.0f,
+                        clock.fixedSteps, clock.droppedSteps);
+
+            ImGui::Checkbox("Cache scene pass", &app->cacheScenePass);
+            ImGui::Text("Scene pass: %s, reused %zu times", app->scenePassCached ? "cached" : "rendered",
+                        app->scenePassesCached);
+        }
+
+        if (ImGui::CollapsingHeader("GPU", ImGuiTreeNodeFlags_DefaultOpen))
+            _drawGpu();
+
+        if (ImGui::CollapsingHeader("Jobs", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            bool deterministic = app->jobs.deterministic;
+            if (ImGui::Checkbox("Deterministic", &deterministic))
+                app->jobs.deterministic = deterministic;
+
+            const JobSystem::Stats &jobs = app->jobs.Statistics();
+            ImGui::Text("Jobs: %zu per frame", jobs.jobs);
+            for (std::size_t i = 0; i != jobs.workers.size(); ++i)
+            {
+                const JobSystem::WorkerStats &worker = jobs.workers[i];
+                char label[64];
+                std::snprintf(label, sizeof(label), "%zu jobs, %zu stolen", worker.jobs, worker.steals);
+                if (i)
+                    ImGui::Text("Worker %zu", i);
+                else
+                    ImGui::Text("Main");
+                ImGui::SameLine(80.0f);
+                ImGui::ProgressBar(worker.utilization, {-1.0f, 0.0f}, label);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Object pool", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            const ObjectPool::Stats &pool = ObjectPool::Shared().Statistics();
+            ImGui::Text("Allocations: %zu, frees: %zu per frame", pool.allocations, pool.deallocations);
+            if (pool.heapFallbacks)
+                ImGui::Text("Heap fallbacks: %zu", pool.heapFallbacks);
+            ImGui::Text("Live blocks: %zu, reserved: %.1f KiB", pool.liveBlocks, pool.reservedBytes / 1024.0f);
+        }
+
+        if (ImGui::CollapsingHeader("Transforms", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            const TransformCache::Stats &transforms = app->transforms.Statistics();
+            ImGui::Text("Recomputed: %zu of %zu", transforms.recomputed, transforms.objects);
+        }
+
+        if (ImGui::CollapsingHeader("Instancing", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::Checkbox("Enabled", &app->instancing);
+
+            const InstanceRenderer::Stats &instances = app->instances.Statistics();
+            ImGui::Text("Batches: %zu, instances: %zu", instances.batches, instances.instances);
+            ImGui::Text("Draw calls: %zu", instances.drawCalls);
+            ImGui::Text("Visible: %zu, culled: %zu", instances.visible, instances.culled);
+            ImGui::Text("Uploaded: %.1f KiB of %.1f KiB", instances.uploadedBytes / 1024.0f,
+                        instances.bufferBytes / 1024.0f);
+        }
+
+        if (ImGui::CollapsingHeader("Render queue", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::Checkbox("Uniform buffers + multi-draw", &app->renderQueue.multiDraw);
+
+            const RenderQueue::Stats &queue = app->renderQueue.Statistics();
+            ImGui::Text("Items: %zu, draw calls: %zu", queue.items, queue.drawCalls);
+            ImGui::Text("Uniform uploads: %zu (%zu skipped)", queue.uniformUploads, queue.uniformUploadsSkipped);
+            ImGui::Text("Submit: %.3f ms", queue.submitMilliseconds);
+        }
+
+        if (ImGui::CollapsingHeader("Culling", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::Checkbox("Frustum culling", &app->culler.enabled);
+
+            const FrustumCuller::Stats &culling = app->culler.Statistics();
+            ImGui::Text("Visible: %zu, culled: %zu", culling.visible, culling.culled);
+            if (culling.unculled)
+                ImGui::Text("Not cullable: %zu", culling.unculled);
+            ImGui::Text("Cull time: %.3f ms", culling.milliseconds);
+        }
+
+        if (ImGui::CollapsingHeader("Scene store", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            const SceneStore::Stats &store = app->storeRenderer.StoreStatistics();
+            const SceneStoreRenderer::Stats &drawn = app->storeRenderer.Statistics();
+            ImGui::Text("Objects: %zu, recomputed: %zu", store.objects, store.recomputed);
+            ImGui::Text("Visible: %zu, culled: %zu", store.visible, store.culled);
+            ImGui::Text("Draw calls: %zu, uploaded: %.1f KiB", drawn.drawCalls, drawn.uploadedBytes / 1024.0f);
+            ImGui::Text("Update: %.3f ms, extract: %.3f ms", store.updateMilliseconds, store.extractMilliseconds);
+
+            // Takes a few seconds on a worker, the editor keeps running meanwhile and competes with
+            // it for the cores. The layer keeps the mesh, so it's never released off the GL thread.
+            if (!_propagationJob.Done())
+            {
+                ImGui::TextUnformatted("Benchmarking propagation...");
+                app->RequestFrame();
+            }
+            else
+            {
+                if (ImGui::Button("Benchmark propagation (1M objects)"))
+                {
+                    _propagationMesh = app->meshLibrary.Get(PrimitiveMeshKey::Cube());
+                    _propagationJob =
+                        app->jobs.Submit([this] { _propagation = BenchmarkPropagation(_propagationMesh); });
+                }
+
+                for (const PropagationTiming &timing : _propagation)
+                    ImGui::Text("%u threads: %.2f ms, %.2fx%s", timing.threads, timing.milliseconds,
+                                timing.speedup, timing.identical ? "" : " (results differ)");
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Spatial index", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            const SceneBvh::Stats &bvh = app->sceneBvh.Statistics();
+            ImGui::Text("Objects: %zu, nodes: %zu", bvh.objects, bvh.nodes);
+            ImGui::Text("Unindexed: %zu", bvh.unindexed);
+            ImGui::Text("SAH cost growth: %.2f, rebuilds: %zu", bvh.costGrowth, bvh.rebuilds);
+        }
+
+        ImGui::End();
+    }
+
+  private:
+    void _drawGpu()
+    {
+        GpuProfiler &gpu = app->gpuProfiler;
+        const GpuProfiler::Stats &stats = gpu.Statistics();
+        if (!stats.supported)
+        {
+            ImGui::Text("Timer queries not supported by the driver");
+            return;
+        }
+
+        ImGui::Checkbox("Timer queries", &gpu.enabled);
+        ImGui::SameLine();
+        if (ImGui::Button("Export CSV"))
+            _exported = gpu.ExportCsv("gpu_timings.csv") ? "Saved gpu_timings.csv" : "Export failed";
+        if (_exported)
+        {
+            ImGui::SameLine();
+            ImGui::TextUnformatted(_exported);
+        }
+
+        ImGui::Text("Read back after %llu frames, %zu dropped", stats.latency, stats.droppedFrames);
+
+        // CPU time the frame kept the main thread busy, waiting for the swap doesn't count
+        ProfileFrame frame;
+        if (app->profiler.CopyFrame(0, frame))
+        {
+            double cpu = 0.0;
+            for (const ProfileSample &sample : frame.samples)
+                if (!sample.depth && std::strcmp(sample.name, "Swap buffers"))
+                    cpu += (sample.end - sample.start) * 1.0e-6;
+            _cpuMilliseconds += (cpu - _cpuMilliseconds) * 0.1;
+        }
+
+        const double gpuMilliseconds = stats.avgMilliseconds;
+        const bool gpuBound = gpuMilliseconds > _cpuMilliseconds;
+        ImGui::Text("CPU %.2f ms, GPU %.2f ms:", _cpuMilliseconds, gpuMilliseconds);
+        ImGui::SameLine();
+        ImGui::TextColored(gpuBound ? ImVec4{1.0f, 0.5f, 0.3f, 1.0f} : ImVec4{0.4f, 0.8f, 1.0f, 1.0f},
+                           gpuBound ? "GPU-bound" : "CPU-bound");
+
+        if (!ImGui::BeginTable("GPU passes", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+            return;
+
+        ImGui::TableSetupColumn("Pass");
+        ImGui::TableSetupColumn("Last (ms)");
+        ImGui::TableSetupColumn("Min (ms)");
+        ImGui::TableSetupColumn("Avg (ms)");
+        ImGui::TableSetupColumn("Max (ms)");
+        ImGui::TableHeadersRow();
+
+        for (const GpuProfiler::PassStats &pass : stats.passes)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%*s%s", int(pass.depth * 2), "", pass.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.lastMilliseconds);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.minMilliseconds);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.avgMilliseconds);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.maxMilliseconds);
+        }
+
+        ImGui::EndTable();
+    }
+
+    Application *app;
+    const char *_exported = nullptr;
+    double _cpuMilliseconds = 0.0;
+
+    // Written by the job, only read once it's done
+    JobHandle _propagationJob;
+    MeshHandle _propagationMesh;
+    std::vector<PropagationTiming> _propagation;
+};
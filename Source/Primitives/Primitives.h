@@ -37,157 +37,102 @@ using Scene3D = SceneGraph::Scene<SceneGraph::MatrixTransformation3D>;
 
 using namespace Math::Literals;
 
-class Plane : public Object3D, public SceneGraph::Drawable3D
+// Phong-shaded object with a mesh shared through the mesh library. Registers itself with the
+// application's picking, instancing and culling systems.
+class Primitive : public Object3D, public SceneGraph::Drawable3D, public Pooled
 {
   public:
-    explicit Plane(Object3D &object, Shaders::PhongGL &shader, SceneGraph::DrawableGroup3D &drawables)
-        : Object3D{&object}, SceneGraph::Drawable3D{*this, &drawables}, _shader{shader}
+    // Takes over a reserved object ID, or registers a new one when given none
+    explicit Primitive(Object3D &object, Shaders::PhongGL &shader, SceneGraph::DrawableGroup3D &drawables,
+                       MeshHandle mesh, const Color4 &color, UnsignedInt id = ObjectIdRegistry::InvalidId)
+        : Object3D{&object}, SceneGraph::Drawable3D{*this, &drawables}, _mesh{std::move(mesh)}, _shader{shader}
     {
-        _mesh = MeshTools::compile(Primitives::grid3DSolid(Vector2i{10, 10}));
-        _color = Color4{0.5f, 0.5f, 0.5f, 1.0f};
-
-        rotateX(-90.0_degf).scale(Vector3{2, 2, 2});
+        Application &app = *Application::singleton();
+        auto transform = new CachedTransform{*this, app.transforms};
+        new BvhPickable{*this, app.sceneBvh, {_mesh, &_mesh->bvh}};
+        _material.diffuseColor = color;
+
+        if (id == ObjectIdRegistry::InvalidId)
+            _id = app.objectIds.Register(this);
+        else
+        {
+            _id = id;
+            app.objectIds.Assign(id, this);
+        }
+
+        new InstancedDrawable{*this, app.instances, *transform, _mesh, _material.diffuseColor, _id};
+        new Cullable{*this, app.culler, *this, *transform, _mesh->boundingCenter, _mesh->boundingRadius};
+    }
 
-        _id = Application::singleton()->_getUniqueID();
+    ~Primitive()
+    {
+        Application::singleton()->objectIds.Unregister(_id);
     }
 
+    static constexpr Color4 DefaultColor{0.5f, 0.5f, 0.5f, 1.0f};
+
   private:
-    void draw(const Matrix4 &transformationMatrix, SceneGraph::Camera3D &camera) override
+    void draw(const Matrix4 &transformationMatrix, SceneGraph::Camera3D &) override
     {
-        _shader.setDiffuseColor(_color)
-            .setAmbientColor(0x111111_rgbf)
-            .setShininess(80.0f)
-            .setLightPositions({Vector4{3.0f, 3.0f, 3.0f, 0.0f}})
-            .setTransformationMatrix(transformationMatrix)
-            .setNormalMatrix(transformationMatrix.normalMatrix())
-            .setProjectionMatrix(camera.projectionMatrix())
-            .draw(_mesh);
+        Application::singleton()->renderQueue.Submit(_shader, _mesh->mesh, _material, transformationMatrix, _id);
     }
 
     uint32_t _id;
-    GL::Mesh _mesh;
+    MeshHandle _mesh;
     Shaders::PhongGL &_shader;
-    Color4 _color; // Keep material props here in future
+    PhongMaterial _material;
 };
 
-class Cube : public Object3D, public SceneGraph::Drawable3D
+class Plane : public Primitive
 {
   public:
-    explicit Cube(Object3D &object, Shaders::PhongGL &shader, SceneGraph::DrawableGroup3D &drawables)
-        : Object3D{&object}, SceneGraph::Drawable3D{*this, &drawables}, _shader{shader}
+    explicit Plane(Object3D &object, Shaders::PhongGL &shader, SceneGraph::DrawableGroup3D &drawables)
+        : Primitive{object, shader, drawables,
+                    Application::singleton()->meshLibrary.Get(PrimitiveMeshKey::Plane({10, 10})), DefaultColor}
     {
-        _mesh = MeshTools::compile(Primitives::cubeSolid());
-        _color = Color4{0.5f, 0.5f, 0.5f, 1.0f};
-        _id = Application::singleton()->_getUniqueID();
+        rotateX(-90.0_degf).scale(Vector3{2, 2, 2});
     }
+};
 
-  private:
-    void draw(const Matrix4 &transformationMatrix, SceneGraph::Camera3D &camera) override
+class Cube : public Primitive
+{
+  public:
+    explicit Cube(Object3D &object, Shaders::PhongGL &shader, SceneGraph::DrawableGroup3D &drawables)
+        : Primitive{object, shader, drawables, Application::singleton()->meshLibrary.Get(PrimitiveMeshKey::Cube()),
+                    DefaultColor}
     {
-        _shader.setDiffuseColor(_color)
-            .setAmbientColor(0x111111_rgbf)
-            .setShininess(80.0f)
-            .setLightPositions({Vector4{3.0f, 3.0f, 3.0f, 0.0f}})
-            .setTransformationMatrix(transformationMatrix)
-            .setNormalMatrix(transformationMatrix.normalMatrix())
-            .setProjectionMatrix(camera.projectionMatrix())
-            .draw(_mesh);
     }
-
-    uint32_t _id;
-    GL::Mesh _mesh;
-    Shaders::PhongGL &_shader;
-    Color4 _color; // Keep material props here in future
 };
 
-class Sphere : public Object3D, public SceneGraph::Drawable3D
+class Sphere : public Primitive
 {
   public:
     explicit Sphere(Object3D &object, Shaders::PhongGL &shader, SceneGraph::DrawableGroup3D &drawables)
-        : Object3D{&object}, SceneGraph::Drawable3D{*this, &drawables}, _shader{shader}
-    {
-        _mesh = MeshTools::compile(Primitives::icosphereSolid(3));
-        _color = Color4{0.5f, 0.5f, 0.5f, 1.0f};
-        _id = Application::singleton()->_getUniqueID();
-    }
-
-  private:
-    void draw(const Matrix4 &transformationMatrix, SceneGraph::Camera3D &camera) override
+        : Primitive{object, shader, drawables, Application::singleton()->meshLibrary.Get(PrimitiveMeshKey::Sphere(3)),
+                    DefaultColor}
     {
-        _shader.setDiffuseColor(_color)
-            .setAmbientColor(0x111111_rgbf)
-            .setShininess(80.0f)
-            .setLightPositions({Vector4{3.0f, 3.0f, 3.0f, 0.0f}})
-            .setTransformationMatrix(transformationMatrix)
-            .setNormalMatrix(transformationMatrix.normalMatrix())
-            .setProjectionMatrix(camera.projectionMatrix())
-            .draw(_mesh);
     }
-
-    uint32_t _id;
-    GL::Mesh _mesh;
-    Shaders::PhongGL &_shader;
-    Color4 _color; // Keep material props here in future
 };
 
-class Cone : public Object3D, public SceneGraph::Drawable3D
+class Cone : public Primitive
 {
   public:
     explicit Cone(Object3D &object, Shaders::PhongGL &shader, SceneGraph::DrawableGroup3D &drawables)
-        : Object3D{&object}, SceneGraph::Drawable3D{*this, &drawables}, _shader{shader}
+        : Primitive{object, shader, drawables,
+                    Application::singleton()->meshLibrary.Get(PrimitiveMeshKey::Cone(10, 16, 1.0f)), DefaultColor}
     {
-        _mesh = MeshTools::compile(Primitives::coneSolid(10, 16, 1));
-        _color = Color4{0.5f, 0.5f, 0.5f, 1.0f};
-        _id = Application::singleton()->_getUniqueID();
     }
-
-  private:
-    void draw(const Matrix4 &transformationMatrix, SceneGraph::Camera3D &camera) override
-    {
-        _shader.setDiffuseColor(_color)
-            .setAmbientColor(0x111111_rgbf)
-            .setShininess(80.0f)
-            .setLightPositions({Vector4{3.0f, 3.0f, 3.0f, 0.0f}})
-            .setTransformationMatrix(transformationMatrix)
-            .setNormalMatrix(transformationMatrix.normalMatrix())
-            .setProjectionMatrix(camera.projectionMatrix())
-            .draw(_mesh);
-    }
-
-    uint32_t _id;
-    GL::Mesh _mesh;
-    Shaders::PhongGL &_shader;
-    Color4 _color; // Keep material props here in future
 };
 
-class Capsule : public Object3D, public SceneGraph::Drawable3D
+class Capsule : public Primitive
 {
   public:
     explicit Capsule(Object3D &object, Shaders::PhongGL &shader, SceneGraph::DrawableGroup3D &drawables)
-        : Object3D{&object}, SceneGraph::Drawable3D{*this, &drawables}, _shader{shader}
+        : Primitive{object, shader, drawables,
+                    Application::singleton()->meshLibrary.Get(PrimitiveMeshKey::Capsule(10, 10, 16, 0.5f)),
+                    DefaultColor}
     {
-        _mesh = MeshTools::compile(Primitives::capsule3DSolid(10, 10, 16, 0.5f));
-        _color = Color4{0.5f, 0.5f, 0.5f, 1.0f};
-        _id = Application::singleton()->_getUniqueID();
     }
-
-  private:
-    void draw(const Matrix4 &transformationMatrix, SceneGraph::Camera3D &camera) override
-    {
-        _shader.setDiffuseColor(_color)
-            .setAmbientColor(0x111111_rgbf)
-            .setShininess(80.0f)
-            .setLightPositions({Vector4{3.0f, 3.0f, 3.0f, 0.0f}})
-            .setTransformationMatrix(transformationMatrix)
-            .setNormalMatrix(transformationMatrix.normalMatrix())
-            .setProjectionMatrix(camera.projectionMatrix())
-            .draw(_mesh);
-    }
-
-    uint32_t _id;
-    GL::Mesh _mesh;
-    Shaders::PhongGL &_shader;
-    Color4 _color; // Keep material props here in future
 };
 
 } // namespace Magnum
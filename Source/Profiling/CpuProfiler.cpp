@@ -0,0 +1,102 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+
+namespace
+{
+
+constexpr std::size_t NoSample = ~std::size_t{};
+
+} // namespace
+
+CpuProfiler::CpuProfiler() : _slots{new Slot[FrameCapacity]}
+{
+}
+
+void CpuProfiler::BeginFrame(unsigned long long frameIndex)
+{
+    const long long now = Now();
+    if (_current)
+    {
+        _current->end = now;
+        _current->sequence.fetch_add(1, std::memory_order_release);
+        _finished.fetch_add(1, std::memory_order_release);
+        _current = nullptr;
+    }
+
+    TraceRecorder &trace = TraceRecorder::Shared();
+    if (_frameStart && trace.Recording())
+        trace.Complete("Frame", nullptr, _frameStart, now);
+    _frameStart = now;
+
+    // Scopes don't span frames
+    _open.clear();
+    if (paused)
+        return;
+
+    // Reuses the slot of the oldest frame, readers see it as gone from now on
+    Slot &slot = _slots[_finished.load(std::memory_order_relaxed) % FrameCapacity];
+    slot.sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.index = frameIndex;
+    slot.start = now;
+    slot.end = now;
+    slot.count = 0;
+    _current = &slot;
+}
+
+void CpuProfiler::Begin(const char *name, const char *owner)
+{
+    if (!_current && !TraceRecorder::Shared().Recording())
+        return;
+
+    const long long now = Now();
+    std::size_t index = NoSample;
+    if (_current && _current->count != MaxSamplesPerFrame)
+    {
+        index = _current->count++;
+        _current->samples[index] = {name, owner, now, 0, unsigned(_open.size())};
+    }
+    _open.push_back({name, owner, now, index});
+}
+
+void CpuProfiler::End()
+{
+    if (_open.empty())
+        return;
+
+    const Scope scope = _open.back();
+    _open.pop_back();
+    const long long now = Now();
+    if (scope.index != NoSample)
+        _current->samples[scope.index].end = now;
+
+    TraceRecorder &trace = TraceRecorder::Shared();
+    if (trace.Recording())
+        trace.Complete(scope.name, scope.owner, scope.start, now);
+}
+
+bool CpuProfiler::CopyFrame(std::size_t age, ProfileFrame &frame) const
+{
+    const std::size_t finished = _finished.load(std::memory_order_acquire);
+    if (age >= std::min(finished, FrameCapacity - 1))
+        return false;
+
+    const Slot &slot = _slots[(finished - 1 - age) % FrameCapacity];
+    const unsigned long long sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+        return false;
+
+    frame.index = slot.index;
+    frame.start = slot.start;
+    frame.end = slot.end;
+    frame.samples.assign(slot.samples, slot.samples + std::min(slot.count, MaxSamplesPerFrame));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+std::size_t CpuProfiler::FrameCount() const
+{
+    return std::min(_finished.load(std::memory_order_acquire), FrameCapacity - 1);
+}
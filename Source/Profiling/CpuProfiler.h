@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "TraceRecorder.h"
+
+// One timed scope. Names are expected to be string literals or otherwise outlive the profiler,
+// scopes compare them by pointer.
+struct ProfileSample
+{
+    const char *name = nullptr;
+    const char *owner = nullptr; // e.g. the layer the callback belongs to, if any
+    long long start = 0;         // nanoseconds on the steady clock
+    long long end = 0;
+    unsigned int depth = 0;
+};
+
+struct ProfileFrame
+{
+    unsigned long long index = 0;
+    long long start = 0;
+    long long end = 0;
+    std::vector<ProfileSample> samples; // in the order the scopes were entered
+};
+
+// Records nested CPU scopes of the main thread into a ring of the last FrameCapacity frames.
+// Every frame has a fixed-size slot guarded by a sequence number: the recording thread never
+// waits, and a reader on another thread copying a frame that is overwritten meanwhile notices
+// and gets nothing instead of a torn frame. While the shared TraceRecorder records, frames and
+// scopes go to the trace as well, also while paused.
+class CpuProfiler
+{
+  public:
+    static constexpr std::size_t FrameCapacity = 300;
+    static constexpr std::size_t MaxSamplesPerFrame = 512;
+
+    CpuProfiler();
+
+    CpuProfiler(const CpuProfiler &) = delete;
+    CpuProfiler &operator=(const CpuProfiler &) = delete;
+
+    // Closes the previous frame and starts recording the next one
+    void BeginFrame(unsigned long long frameIndex);
+
+    // Scopes beyond MaxSamplesPerFrame are dropped
+    void Begin(const char *name, const char *owner = nullptr);
+    void End();
+
+    // Copies a finished frame, age 0 being the last one. Returns false if there's no such frame
+    // or it got overwritten while copying.
+    bool CopyFrame(std::size_t age, ProfileFrame &frame) const;
+
+    // Number of finished frames available
+    std::size_t FrameCount() const;
+
+    long long Now() const
+    {
+        return TraceRecorder::Now();
+    }
+
+    // Keeps the recorded frames as they are, e.g. to inspect a spike
+    bool paused = false;
+
+  private:
+    struct Scope
+    {
+        const char *name;
+        const char *owner;
+        long long start;
+        std::size_t index; // of the sample, NoSample if dropped
+    };
+
+    struct Slot
+    {
+        // Odd while the frame is being recorded
+        std::atomic<unsigned long long> sequence{0};
+        unsigned long long index = 0;
+        long long start = 0;
+        long long end = 0;
+        std::size_t count = 0;
+        ProfileSample samples[MaxSamplesPerFrame];
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    std::atomic<std::size_t> _finished{0}; // frames finished in total
+    Slot *_current = nullptr;
+    long long _frameStart = 0;
+
+    // Open scopes of the current frame
+    std::vector<Scope> _open;
+};
+
+// Times the enclosing scope
+class ProfileScope
+{
+  public:
+    explicit ProfileScope(CpuProfiler &profiler, const char *name, const char *owner = nullptr)
+        : _profiler(profiler)
+    {
+        _profiler.Begin(name, owner);
+    }
+
+    ~ProfileScope()
+    {
+        _profiler.End();
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+  private:
+    CpuProfiler &_profiler;
+};
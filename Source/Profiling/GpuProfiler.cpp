@@ -0,0 +1,220 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/OpenGL.h>
+
+#include "TraceRecorder.h"
+
+using namespace Magnum;
+
+namespace
+{
+
+constexpr std::size_t NoPass = ~std::size_t{};
+
+} // namespace
+
+void GpuProfiler::BeginFrame(unsigned long long frameIndex)
+{
+    // Queries are created on first use so the profiler can live in the application before the
+    // GL context exists
+    if (!_checkedSupport)
+    {
+        _checkedSupport = true;
+        _stats.supported = GL::Context::current().isExtensionSupported<GL::Extensions::ARB::timer_query>();
+    }
+
+    _current = nullptr;
+    _open.clear();
+
+    // Oldest first, results of later frames can't be ready before those of earlier ones
+    bool resolved = false;
+    for (std::size_t i = 0; i != Latency; ++i)
+    {
+        Slot &slot = _slots[(_next + i) % Latency];
+        if (!slot.recorded)
+            continue;
+        if (!_resolve(slot))
+            break;
+        _stats.latency = frameIndex - slot.frame;
+        resolved = true;
+    }
+    if (resolved)
+        _updateStatistics();
+
+    if (!_stats.supported || !enabled)
+        return;
+
+    // Reading the GPU clock directly doesn't wait for queued commands, the clocks drift apart
+    // only slowly
+    if (TraceRecorder::Shared().Recording() && (!_gpuToCpu || frameIndex - _calibratedFrame >= CalibrationFrames))
+    {
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        _gpuToCpu = TraceRecorder::Now() - gpuNow;
+        _calibratedFrame = frameIndex;
+    }
+
+    // The GPU is more than Latency frames behind, give up on the oldest frame rather than wait
+    Slot &slot = _slots[_next];
+    if (slot.recorded)
+    {
+        slot.recorded = false;
+        ++_stats.droppedFrames;
+    }
+
+    _next = (_next + 1) % Latency;
+    slot.frame = frameIndex;
+    slot.count = 0;
+    _current = &slot;
+}
+
+void GpuProfiler::Begin(const char *name)
+{
+    if (!_current)
+        return;
+
+    Slot &slot = *_current;
+    if (slot.count == MaxPassesPerFrame)
+    {
+        _open.push_back(NoPass);
+        return;
+    }
+
+    const std::size_t index = slot.count++;
+    if (slot.begins.size() == index)
+    {
+        slot.begins.emplace_back(GL::TimeQuery::Target::Timestamp);
+        slot.ends.emplace_back(GL::TimeQuery::Target::Timestamp);
+    }
+
+    slot.passes[index] = {name, unsigned(_open.size()), false};
+    slot.begins[index].timestamp();
+    slot.lastPass = index;
+    slot.lastIsEnd = false;
+    _open.push_back(index);
+
+    // Anything with a query counts as recorded, even if its scope is left open
+    slot.recorded = true;
+}
+
+void GpuProfiler::End()
+{
+    if (!_current || _open.empty())
+        return;
+
+    const std::size_t index = _open.back();
+    _open.pop_back();
+    if (index == NoPass)
+        return;
+
+    Slot &slot = *_current;
+    slot.ends[index].timestamp();
+    slot.passes[index].closed = true;
+    slot.lastPass = index;
+    slot.lastIsEnd = true;
+}
+
+bool GpuProfiler::_resolve(Slot &slot)
+{
+    // The queries of a frame finish in the order they were issued, once the last one is done all
+    // of them are
+    GL::TimeQuery &last = slot.lastIsEnd ? slot.ends[slot.lastPass] : slot.begins[slot.lastPass];
+    if (!last.resultAvailable())
+        return false;
+
+    slot.recorded = false;
+    ++_stats.resolvedFrames;
+
+    if (_history.size() == HistoryCapacity)
+        _history.pop_front();
+    _history.emplace_back();
+    GpuFrameTiming &frame = _history.back();
+    frame.index = slot.frame;
+    frame.passes.reserve(slot.count);
+
+    TraceRecorder &trace = TraceRecorder::Shared();
+    const bool tracing = trace.Recording() && _gpuToCpu;
+
+    for (std::size_t i = 0; i != slot.count; ++i)
+    {
+        // The end query of an open pass was never issued in this frame
+        if (!slot.passes[i].closed)
+            continue;
+
+        const UnsignedLong begin = slot.begins[i].result<UnsignedLong>();
+        const UnsignedLong end = slot.ends[i].result<UnsignedLong>();
+        const double milliseconds = end > begin ? (end - begin) * 1.0e-6 : 0.0;
+
+        frame.passes.push_back({slot.passes[i].name, slot.passes[i].depth, milliseconds});
+        if (tracing)
+            trace.CompleteGpu(slot.passes[i].name, _gpuToCpu + static_cast<long long>(begin),
+                              _gpuToCpu + static_cast<long long>(end));
+        if (!slot.passes[i].depth)
+            frame.milliseconds += milliseconds;
+    }
+
+    return true;
+}
+
+void GpuProfiler::_updateStatistics()
+{
+    std::vector<PassStats> &passes = _stats.passes;
+    std::vector<std::size_t> counts(passes.size());
+    for (PassStats &pass : passes)
+        pass = {pass.name, pass.depth, 0.0, 0.0, 0.0, 0.0};
+
+    double total = 0.0;
+    for (const GpuFrameTiming &frame : _history)
+    {
+        total += frame.milliseconds;
+        for (const GpuPassTiming &timing : frame.passes)
+        {
+            auto found = std::find_if(passes.begin(), passes.end(), [&timing](const PassStats &pass) {
+                return pass.name == timing.name && pass.depth == timing.depth;
+            });
+            if (found == passes.end())
+            {
+                passes.push_back({timing.name, timing.depth, 0.0, 0.0, 0.0, 0.0});
+                counts.push_back(0);
+                found = passes.end() - 1;
+            }
+
+            PassStats &pass = *found;
+            std::size_t &count = counts[found - passes.begin()];
+            pass.lastMilliseconds = timing.milliseconds;
+            pass.minMilliseconds = count ? std::min(pass.minMilliseconds, timing.milliseconds) : timing.milliseconds;
+            pass.maxMilliseconds = std::max(pass.maxMilliseconds, timing.milliseconds);
+            pass.avgMilliseconds += timing.milliseconds;
+            ++count;
+        }
+    }
+
+    for (std::size_t i = 0; i != passes.size(); ++i)
+        if (counts[i])
+            passes[i].avgMilliseconds /= counts[i];
+
+    _stats.lastMilliseconds = _history.empty() ? 0.0 : _history.back().milliseconds;
+    _stats.avgMilliseconds = _history.empty() ? 0.0 : total / _history.size();
+}
+
+bool GpuProfiler::ExportCsv(const std::string &path) const
+{
+    std::ofstream file{path};
+    if (!file)
+        return false;
+
+    file << "frame,pass,depth,milliseconds\n";
+    for (const GpuFrameTiming &frame : _history)
+    {
+        for (const GpuPassTiming &pass : frame.passes)
+            file << frame.index << ',' << pass.name << ',' << pass.depth << ',' << pass.milliseconds << '\n';
+        file << frame.index << ",Frame,0," << frame.milliseconds << '\n';
+    }
+
+    return bool(file);
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <Magnum/GL/TimeQuery.h>
+
+struct GpuPassTiming
+{
+    const char *name = nullptr;
+    unsigned int depth = 0;
+    double milliseconds = 0.0;
+};
+
+struct GpuFrameTiming
+{
+    unsigned long long index = 0;
+    double milliseconds = 0.0; // top-level passes summed up
+    std::vector<GpuPassTiming> passes;
+};
+
+// Times render passes on the GPU with timestamp queries. Every frame writes its queries into
+// one slot of a ring of Latency frames, and a slot is read back only once the query issued last
+// has a result, which is usually a frame or two later, so the CPU never waits for the GPU. A
+// slot still busy when it's needed again is dropped, passes left open at the end of a frame
+// aren't reported. Without ARB_timer_query profiling is a no-op.
+// While the shared TraceRecorder records, resolved passes go to its GPU timeline, shifted to
+// the CPU clock by an offset measured every CalibrationFrames frames.
+class GpuProfiler
+{
+  public:
+    static constexpr std::size_t Latency = 4;
+    static constexpr std::size_t MaxPassesPerFrame = 32;
+    static constexpr std::size_t HistoryCapacity = 300;
+    static constexpr unsigned long long CalibrationFrames = 300;
+
+    struct PassStats
+    {
+        const char *name = nullptr;
+        unsigned int depth = 0;
+        double lastMilliseconds = 0.0;
+        double minMilliseconds = 0.0;
+        double avgMilliseconds = 0.0;
+        double maxMilliseconds = 0.0;
+    };
+
+    struct Stats
+    {
+        bool supported = false;
+        std::size_t resolvedFrames = 0;
+        std::size_t droppedFrames = 0;
+        unsigned long long latency = 0; // frames between recording and reading back
+        double lastMilliseconds = 0.0;
+        double avgMilliseconds = 0.0;
+        std::vector<PassStats> passes; // over the whole history, in first-seen order
+    };
+
+    GpuProfiler() = default;
+
+    GpuProfiler(const GpuProfiler &) = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    // Collects finished frames and starts recording the next one. Needs a current GL context.
+    void BeginFrame(unsigned long long frameIndex);
+
+    // Passes beyond MaxPassesPerFrame are dropped. Names are compared by pointer.
+    void Begin(const char *name);
+    void End();
+
+    // Frames read back so far, oldest first
+    const std::deque<GpuFrameTiming> &History() const
+    {
+        return _history;
+    }
+
+    // Writes the history as frame,pass,depth,milliseconds lines
+    bool ExportCsv(const std::string &path) const;
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    bool enabled = true;
+
+  private:
+    struct Pass
+    {
+        const char *name = nullptr;
+        unsigned int depth = 0;
+        bool closed = false;
+    };
+
+    struct Slot
+    {
+        unsigned long long frame = 0;
+        bool recorded = false;
+        std::size_t count = 0;
+        Pass passes[MaxPassesPerFrame];
+        std::vector<Magnum::GL::TimeQuery> begins;
+        std::vector<Magnum::GL::TimeQuery> ends;
+
+        // Query issued last, ends[lastPass] or begins[lastPass]. Nested passes end before the
+        // ones around them, so it isn't the end of the last pass.
+        std::size_t lastPass = 0;
+        bool lastIsEnd = false;
+    };
+
+    bool _resolve(Slot &slot);
+    void _updateStatistics();
+
+    Slot _slots[Latency];
+    Slot *_current = nullptr;
+    std::size_t _next = 0;
+    bool _checkedSupport = false;
+
+    // Steady clock minus GPU clock, zero until measured
+    long long _gpuToCpu = 0;
+    unsigned long long _calibratedFrame = 0;
+
+    // Indices of the open passes in the current frame, NoPass for dropped ones
+    std::vector<std::size_t> _open;
+
+    std::deque<GpuFrameTiming> _history;
+    Stats _stats;
+};
+
+// Times the enclosing scope on the GPU
+class GpuScope
+{
+  public:
+    explicit GpuScope(GpuProfiler &profiler, const char *name) : _profiler(profiler)
+    {
+        _profiler.Begin(name);
+    }
+
+    ~GpuScope()
+    {
+        _profiler.End();
+    }
+
+    GpuScope(const GpuScope &) = delete;
+    GpuScope &operator=(const GpuScope &) = delete;
+
+  private:
+    GpuProfiler &_profiler;
+};
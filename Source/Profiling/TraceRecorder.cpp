@@ -0,0 +1,178 @@
+#include "TraceRecorder.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+
+// Processes the tracks are grouped in
+constexpr unsigned int CpuProcess = 1;
+constexpr unsigned int GpuProcess = 2;
+
+void writeString(std::FILE *file, const char *string)
+{
+    std::fputc('"', file);
+    for (; *string; ++string)
+    {
+        if (*string == '"' || *string == '\\')
+            std::fputc('\\', file);
+        if (static_cast<unsigned char>(*string) >= 0x20)
+            std::fputc(*string, file);
+    }
+    std::fputc('"', file);
+}
+
+void writeMetadata(std::FILE *file, const char *kind, unsigned int process, unsigned int thread, const char *name)
+{
+    std::fprintf(file, ",\n{\"ph\":\"M\",\"name\":\"%s\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":", kind, process,
+                 thread);
+    writeString(file, name);
+    std::fputs("}}", file);
+}
+
+} // namespace
+
+TraceRecorder &TraceRecorder::Shared()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+long long TraceRecorder::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void TraceRecorder::Start()
+{
+    {
+        std::lock_guard<std::mutex> lock{_buffersMutex};
+        for (const std::unique_ptr<Buffer> &buffer : _buffers)
+        {
+            std::lock_guard<std::mutex> bufferLock{buffer->mutex};
+            buffer->events.clear();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock{_gpu.mutex};
+        _gpu.events.clear();
+    }
+
+    _dropped.store(0, std::memory_order_relaxed);
+    _start = Now();
+    _recording.store(true, std::memory_order_relaxed);
+}
+
+void TraceRecorder::Stop()
+{
+    _recording.store(false, std::memory_order_relaxed);
+}
+
+void TraceRecorder::Complete(const char *name, const char *owner, long long start, long long end)
+{
+    _append(_threadBuffer(), {name, owner, start, end});
+}
+
+void TraceRecorder::CompleteGpu(const char *name, long long start, long long end)
+{
+    _append(_gpu, {name, nullptr, start, end});
+}
+
+void TraceRecorder::NameThread(std::string name)
+{
+    Buffer &buffer = _threadBuffer();
+    std::lock_guard<std::mutex> lock{buffer.mutex};
+    buffer.name = std::move(name);
+}
+
+TraceRecorder::Buffer &TraceRecorder::_threadBuffer()
+{
+    // Buffers stay with the recorder when their thread exits
+    static thread_local Buffer *buffer = nullptr;
+    if (!buffer)
+    {
+        std::lock_guard<std::mutex> lock{_buffersMutex};
+        _buffers.emplace_back(new Buffer);
+        buffer = _buffers.back().get();
+        buffer->id = unsigned(_buffers.size());
+        buffer->events.reserve(4096);
+    }
+    return *buffer;
+}
+
+void TraceRecorder::_append(Buffer &buffer, const Event &event)
+{
+    std::lock_guard<std::mutex> lock{buffer.mutex};
+    if (buffer.events.size() == MaxEventsPerThread)
+    {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events.push_back(event);
+}
+
+std::size_t TraceRecorder::EventCount() const
+{
+    std::size_t count = 0;
+    std::lock_guard<std::mutex> lock{_buffersMutex};
+    for (const std::unique_ptr<Buffer> &buffer : _buffers)
+    {
+        std::lock_guard<std::mutex> bufferLock{buffer->mutex};
+        count += buffer->events.size();
+    }
+    std::lock_guard<std::mutex> gpuLock{_gpu.mutex};
+    return count + _gpu.events.size();
+}
+
+bool TraceRecorder::Write(const std::string &path) const
+{
+    std::FILE *file = std::fopen(path.data(), "w");
+    if (!file)
+        return false;
+
+    // Every event after the first one starts with the separator, the format allows no trailing comma
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    std::fprintf(file, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%u,\"tid\":0,\"args\":{\"name\":\"CPU\"}}",
+                 CpuProcess);
+    writeMetadata(file, "process_name", GpuProcess, 0, "GPU");
+    writeMetadata(file, "thread_name", GpuProcess, 1, "Render passes");
+
+    // Microseconds since Start()
+    const auto writeEvents = [this, file](const Buffer &buffer, unsigned int process, unsigned int thread) {
+        for (const Event &event : buffer.events)
+        {
+            std::fputs(",\n{\"ph\":\"X\",\"name\":", file);
+            if (event.owner)
+            {
+                const std::string name = std::string{event.owner} + "::" + event.name;
+                writeString(file, name.data());
+            }
+            else
+                writeString(file, event.name);
+            std::fprintf(file, ",\"cat\":\"%s\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                         process == GpuProcess ? "gpu" : "cpu", process, thread, (event.start - _start) * 1.0e-3,
+                         (event.end - event.start) * 1.0e-3);
+        }
+    };
+
+    {
+        std::lock_guard<std::mutex> lock{_buffersMutex};
+        for (const std::unique_ptr<Buffer> &buffer : _buffers)
+        {
+            std::lock_guard<std::mutex> bufferLock{buffer->mutex};
+            if (!buffer->name.empty())
+                writeMetadata(file, "thread_name", CpuProcess, buffer->id, buffer->name.data());
+            writeEvents(*buffer, CpuProcess, buffer->id);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock{_gpu.mutex};
+        writeEvents(_gpu, GpuProcess, 1);
+    }
+
+    std::fputs("\n]}\n", file);
+    return std::fclose(file) == 0;
+}
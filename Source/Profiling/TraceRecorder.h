@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records timed events of every thread for a Chrome/Perfetto trace (Trace Event Format JSON).
+// Each thread appends to a buffer of its own, the lock guarding it is only ever contended while
+// a trace is being written. While not recording, instrumented code pays a single relaxed load
+// for Recording().
+//
+// Times are nanoseconds on the steady clock, as returned by Now(). Names are expected to be
+// string literals or otherwise outlive the recorder.
+class TraceRecorder
+{
+  public:
+    static constexpr std::size_t MaxEventsPerThread = 1 << 20;
+
+    static TraceRecorder &Shared();
+
+    static long long Now();
+
+    TraceRecorder(const TraceRecorder &) = delete;
+    TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+    // Drops whatever was recorded before
+    void Start();
+    void Stop();
+
+    bool Recording() const
+    {
+        return _recording.load(std::memory_order_relaxed);
+    }
+
+    // Scope of the calling thread, shown as owner::name if there's an owner
+    void Complete(const char *name, const char *owner, long long start, long long end);
+
+    // Pass on the GPU timeline, with times already converted to the steady clock
+    void CompleteGpu(const char *name, long long start, long long end);
+
+    // Shown in place of the thread ID
+    void NameThread(std::string name);
+
+    bool Write(const std::string &path) const;
+
+    std::size_t EventCount() const;
+    std::size_t DroppedCount() const
+    {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    // Only the shared recorder exists, the buffer of each thread is cached in a thread_local that
+    // can't tell recorders apart
+    TraceRecorder() = default;
+
+    struct Event
+    {
+        const char *name;
+        const char *owner;
+        long long start;
+        long long end;
+    };
+
+    struct Buffer
+    {
+        mutable std::mutex mutex;
+        unsigned int id = 0;
+        std::string name;
+        std::vector<Event> events;
+    };
+
+    Buffer &_threadBuffer();
+    void _append(Buffer &buffer, const Event &event);
+
+    std::atomic<bool> _recording{false};
+    std::atomic<std::size_t> _dropped{0};
+    long long _start = 0;
+
+    // Registration of new threads only
+    mutable std::mutex _buffersMutex;
+    std::vector<std::unique_ptr<Buffer>> _buffers;
+    Buffer _gpu;
+};
@@ -0,0 +1,132 @@
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/Math/Vector4.h>
+
+#include "SphereCulling.h"
+
+using namespace Magnum;
+
+void FrustumCuller::BeginFrame()
+{
+    _stats = {};
+}
+
+void FrustumCuller::Draw(SceneGraph::Camera3D &camera, SceneGraph::DrawableGroup3D &group)
+{
+    auto found = _groups.find(&group);
+    if (found == _groups.end() || found->second.entries.size() != group.size())
+    {
+        _stats.unculled += group.size();
+        camera.draw(group);
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Makes sure the camera matrix is up to date
+    camera.object().setClean();
+    const Matrix4 cameraMatrix = camera.cameraMatrix();
+
+    Group &data = found->second;
+    const std::size_t count = data.entries.size();
+    if (enabled)
+    {
+        Vector4 planes[6];
+        SphereCulling::ExtractPlanes(camera.projectionMatrix() * cameraMatrix, planes);
+
+        _visible.resize(data.x.size());
+        SphereCulling::TestSpheres(planes, data.x.data(), data.y.data(), data.z.data(), data.radius.data(),
+                                   count, _visible.data());
+    }
+    else
+        _visible.assign(data.x.size(), 1);
+
+    _drawList.clear();
+    for (std::size_t i = 0; i != count; ++i)
+    {
+        if (!_visible[i])
+            continue;
+
+        Cullable &entry = *data.entries[i];
+        _drawList.emplace_back(entry._drawable, cameraMatrix * entry._transform.World());
+    }
+
+    _stats.visible += _drawList.size();
+    _stats.culled += count - _drawList.size();
+    _stats.milliseconds +=
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    camera.draw(_drawList);
+}
+
+void FrustumCuller::_add(Cullable &entry)
+{
+    Group &data = _groups[entry._group];
+    entry._index = data.entries.size();
+    data.entries.push_back(&entry);
+
+    // Padding never passes the test
+    const std::size_t padded = SphereCulling::PaddedSize(data.entries.size());
+    data.x.resize(padded, 0.0f);
+    data.y.resize(padded, 0.0f);
+    data.z.resize(padded, 0.0f);
+    data.radius.resize(padded, -Constants::inf());
+}
+
+void FrustumCuller::_remove(Cullable &entry)
+{
+    // Move the last entry into the gap
+    Group &data = _groups[entry._group];
+    const std::size_t last = data.entries.size() - 1;
+    if (entry._index != last)
+    {
+        data.entries[entry._index] = data.entries[last];
+        data.entries[entry._index]->_index = entry._index;
+        data.x[entry._index] = data.x[last];
+        data.y[entry._index] = data.y[last];
+        data.z[entry._index] = data.z[last];
+        data.radius[entry._index] = data.radius[last];
+    }
+    data.entries.pop_back();
+    data.radius[last] = -Constants::inf();
+
+    const std::size_t padded = SphereCulling::PaddedSize(data.entries.size());
+    data.x.resize(padded);
+    data.y.resize(padded);
+    data.z.resize(padded);
+    data.radius.resize(padded);
+}
+
+Cullable::Cullable(Object3D &object, FrustumCuller &culler, SceneGraph::Drawable3D &drawable,
+                   const CachedTransform &transform, const Vector3 &center, Float radius)
+    : SceneGraph::AbstractFeature3D{object}, _culler(culler), _drawable(drawable),
+      _group(drawable.drawables()), _transform(transform), _center{center}, _radius{radius}
+{
+    setCachedTransformations(SceneGraph::CachedTransformation::Absolute);
+
+    _culler._add(*this);
+}
+
+Cullable::~Cullable()
+{
+    _culler._remove(*this);
+}
+
+void Cullable::clean(const Matrix4 &absoluteTransformationMatrix)
+{
+    // Non-uniform scaling stretches the sphere by the largest axis scale
+    const Matrix3x3 scaling = absoluteTransformationMatrix.rotationScaling();
+    const Float scale = Math::sqrt(Math::max(Math::max(scaling[0].dot(), scaling[1].dot()), scaling[2].dot()));
+    const Vector3 center = absoluteTransformationMatrix.transformPoint(_center);
+
+    FrustumCuller::Group &data = _culler._groups[_group];
+    data.x[_index] = center.x();
+    data.y[_index] = center.y();
+    data.z[_index] = center.z();
+    data.radius[_index] = _radius * scale;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/SceneGraph/AbstractFeature.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/SceneGraph/Drawable.h>
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+#include <Magnum/SceneGraph/Object.h>
+
+#include "ObjectPool.h"
+#include "TransformCache.h"
+
+using Object3D = Magnum::SceneGraph::Object<Magnum::SceneGraph::MatrixTransformation3D>;
+
+class Cullable;
+
+// Draws drawable groups with everything outside of the camera frustum left out. Every drawable
+// of a group needs a Cullable feature holding its bounding sphere; the world-space spheres are
+// kept in structure-of-arrays form and tested against the frustum planes four at a time. Visible
+// drawables are drawn with the world transformations from their CachedTransform, so the scene
+// graph doesn't have to compute them again.
+class FrustumCuller
+{
+  public:
+    struct Stats
+    {
+        // Since the last BeginFrame()
+        std::size_t visible = 0;
+        std::size_t culled = 0;
+        std::size_t unculled = 0; // in groups that are not fully covered
+        double milliseconds = 0.0;
+    };
+
+    FrustumCuller() = default;
+
+    FrustumCuller(const FrustumCuller &) = delete;
+    FrustumCuller &operator=(const FrustumCuller &) = delete;
+
+    void BeginFrame();
+
+    // Drop-in replacement for camera.draw(group). Groups with drawables lacking a Cullable
+    // feature are drawn whole.
+    void Draw(Magnum::SceneGraph::Camera3D &camera, Magnum::SceneGraph::DrawableGroup3D &group);
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    // When disabled covered groups are drawn whole, still from the cached transformations
+    bool enabled = true;
+
+  private:
+    friend Cullable;
+
+    // Bounding spheres of one drawable group
+    struct Group
+    {
+        std::vector<Cullable *> entries;
+        std::vector<Magnum::Float> x, y, z, radius;
+    };
+
+    void _add(Cullable &entry);
+    void _remove(Cullable &entry);
+
+    std::unordered_map<Magnum::SceneGraph::DrawableGroup3D *, Group> _groups;
+
+    std::vector<Magnum::UnsignedByte> _visible;
+    std::vector<std::pair<std::reference_wrapper<Magnum::SceneGraph::Drawable3D>, Magnum::Matrix4>> _drawList;
+
+    Stats _stats;
+};
+
+// Bounding sphere of a drawable for FrustumCuller, in the space of the object it's attached
+// to. The drawable has to be in a group already and stay in it, the transform has to be attached
+// to the same object.
+class Cullable : public Magnum::SceneGraph::AbstractFeature3D, public Pooled
+{
+  public:
+    explicit Cullable(Object3D &object, FrustumCuller &culler, Magnum::SceneGraph::Drawable3D &drawable,
+                      const CachedTransform &transform, const Magnum::Vector3 &center, Magnum::Float radius);
+    ~Cullable();
+
+  private:
+    friend FrustumCuller;
+
+    void clean(const Magnum::Matrix4 &absoluteTransformationMatrix) override;
+
+    FrustumCuller &_culler;
+    Magnum::SceneGraph::Drawable3D &_drawable;
+    Magnum::SceneGraph::DrawableGroup3D *_group;
+    const CachedTransform &_transform;
+
+    Magnum::Vector3 _center;
+    Magnum::Float _radius;
+
+    std::size_t _index = 0;
+};
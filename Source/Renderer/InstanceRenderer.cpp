@@ -0,0 +1,258 @@
+#include "InstanceRenderer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <Corrade/Containers/ArrayViewStl.h>
+#include <Magnum/Math/Constants.h>
+#include <Magnum/Math/Functions.h>
+
+#include "RenderStats.h"
+#include "SphereCulling.h"
+
+using namespace Magnum;
+
+InstanceBatch::InstanceBatch(MeshHandle resource) : _resource{std::move(resource)}
+{
+    _mesh = _resource->CreateMesh();
+    _mesh.addVertexBufferInstanced(_instanceBuffer, 1, 0, Shaders::PhongGL::TransformationMatrix{},
+                                   Shaders::PhongGL::NormalMatrix{}, Shaders::PhongGL::Color4{},
+                                   Shaders::PhongGL::ObjectId{});
+    _mesh.setInstanceCount(0);
+
+    _visibleMesh = _resource->CreateMesh();
+    _visibleMesh.addVertexBufferInstanced(_visibleBuffer, 1, 0, Shaders::PhongGL::TransformationMatrix{},
+                                          Shaders::PhongGL::NormalMatrix{}, Shaders::PhongGL::Color4{},
+                                          Shaders::PhongGL::ObjectId{});
+}
+
+void InstanceBatch::_add(InstancedDrawable &member)
+{
+    member._index = _members.size();
+    _members.push_back(&member);
+    _instances.emplace_back();
+    _touch(member._index);
+
+    // Culled until the first clean gives it a sphere
+    _resizeSpheres();
+    _radius[member._index] = -Constants::inf();
+}
+
+void InstanceBatch::_remove(InstancedDrawable &member)
+{
+    // Move the last instance into the gap so the buffer stays dense
+    const std::size_t last = _members.size() - 1;
+    if (member._index != last)
+    {
+        _members[member._index] = _members[last];
+        _members[member._index]->_index = member._index;
+        _instances[member._index] = _instances[last];
+        _x[member._index] = _x[last];
+        _y[member._index] = _y[last];
+        _z[member._index] = _z[last];
+        _radius[member._index] = _radius[last];
+        _touch(member._index);
+    }
+
+    _members.pop_back();
+    _instances.pop_back();
+    _radius[last] = -Constants::inf();
+    _resizeSpheres();
+    _dirtyEnd = Math::min(_dirtyEnd, _instances.size());
+    if (_dirtyBegin >= _dirtyEnd)
+        _dirtyBegin = _dirtyEnd = 0;
+}
+
+void InstanceBatch::_touch(std::size_t index)
+{
+    if (_dirtyBegin == _dirtyEnd)
+    {
+        _dirtyBegin = index;
+        _dirtyEnd = index + 1;
+        return;
+    }
+
+    _dirtyBegin = Math::min(_dirtyBegin, index);
+    _dirtyEnd = Math::max(_dirtyEnd, index + 1);
+}
+
+void InstanceBatch::_resizeSpheres()
+{
+    // Padding has a radius of -inf and never passes
+    const std::size_t padded = SphereCulling::PaddedSize(_instances.size());
+    _x.resize(padded, 0.0f);
+    _y.resize(padded, 0.0f);
+    _z.resize(padded, 0.0f);
+    _radius.resize(padded, -Constants::inf());
+}
+
+std::size_t InstanceBatch::_upload()
+{
+    _mesh.setInstanceCount(Int(_instances.size()));
+
+    std::size_t uploaded = 0;
+    if (_instances.size() > _bufferCapacity)
+    {
+        // Grow along with the vector so that adding objects one by one doesn't reallocate the
+        // buffer every time
+        _bufferCapacity = _instances.capacity();
+        _instanceBuffer.setData({nullptr, _bufferCapacity * sizeof(InstanceData)}, GL::BufferUsage::DynamicDraw);
+        _instanceBuffer.setSubData(0, Containers::arrayView(_instances));
+        uploaded = _instances.size() * sizeof(InstanceData);
+    }
+    else if (_dirtyBegin != _dirtyEnd)
+    {
+        _instanceBuffer.setSubData(_dirtyBegin * sizeof(InstanceData),
+                                   Containers::arrayView(_instances).slice(_dirtyBegin, _dirtyEnd));
+        uploaded = (_dirtyEnd - _dirtyBegin) * sizeof(InstanceData);
+    }
+
+    _dirtyBegin = _dirtyEnd = 0;
+    return uploaded;
+}
+
+void InstanceRenderer::Update()
+{
+    // Batches without members would keep their mesh alive in the library
+    for (auto it = _batches.begin(); it != _batches.end();)
+    {
+        if (it->second->_members.empty())
+            it = _batches.erase(it);
+        else
+            ++it;
+    }
+}
+
+void InstanceRenderer::Draw(Shaders::PhongGL &shader, SceneGraph::Camera3D &camera)
+{
+    Update();
+
+    // Instance transformations are absolute, the uniform matrices take them to camera space.
+    // The instance ID is added to the uniform one.
+    const Matrix4 cameraMatrix = camera.cameraMatrix();
+    shader.setTransformationMatrix(cameraMatrix)
+        .setNormalMatrix(cameraMatrix.normalMatrix())
+        .setProjectionMatrix(camera.projectionMatrix())
+        .setObjectId(0);
+    RenderStats &renderStats = RenderStats::Shared();
+    renderStats.UniformsSet(4);
+
+    Vector4 planes[6];
+    if (culling)
+        SphereCulling::ExtractPlanes(camera.projectionMatrix() * cameraMatrix, planes);
+
+    _stats.batches = _batches.size();
+    _stats.instances = 0;
+    _stats.bufferBytes = 0;
+    _stats.drawCalls = 0;
+    _stats.uploadedBytes = 0;
+    _stats.visible = 0;
+    _stats.culled = 0;
+
+    for (auto &entry : _batches)
+    {
+        InstanceBatch &batch = *entry.second;
+        const std::size_t uploaded = batch._upload();
+        _stats.uploadedBytes += uploaded;
+        renderStats.Uploaded(uploaded);
+        _stats.instances += batch._instances.size();
+        _stats.bufferBytes += (batch._bufferCapacity + batch._visibleCapacity) * sizeof(InstanceData);
+
+        const std::size_t count = batch._instances.size();
+        std::size_t visible = count;
+        if (culling)
+        {
+            _visible.resize(batch._x.size());
+            SphereCulling::TestSpheres(planes, batch._x.data(), batch._y.data(), batch._z.data(),
+                                       batch._radius.data(), count, _visible.data());
+            visible = std::size_t(std::count(_visible.begin(), _visible.begin() + count, 1));
+        }
+        _stats.visible += visible;
+        _stats.culled += count - visible;
+
+        if (!visible)
+            continue;
+
+        // The whole buffer is up to date already, a partial one has to be put together
+        GL::Mesh *mesh = &batch._mesh;
+        if (visible != count)
+        {
+            _visibleInstances.clear();
+            for (std::size_t i = 0; i != count; ++i)
+                if (_visible[i])
+                    _visibleInstances.push_back(batch._instances[i]);
+
+            if (visible > batch._visibleCapacity)
+            {
+                batch._visibleCapacity = batch._instances.capacity();
+                batch._visibleBuffer.setData({nullptr, batch._visibleCapacity * sizeof(InstanceData)},
+                                             GL::BufferUsage::StreamDraw);
+            }
+            batch._visibleBuffer.setSubData(0, Containers::arrayView(_visibleInstances));
+            batch._visibleMesh.setInstanceCount(Int(visible));
+            _stats.uploadedBytes += visible * sizeof(InstanceData);
+            renderStats.Uploaded(visible * sizeof(InstanceData));
+            mesh = &batch._visibleMesh;
+        }
+
+        shader.draw(*mesh);
+        ++_stats.drawCalls;
+        renderStats.Draw(&shader, *mesh);
+    }
+}
+
+void InstanceRenderer::Reserve(const MeshHandle &mesh, std::size_t count)
+{
+    InstanceBatch &batch = _batchFor(mesh);
+    batch._instances.reserve(batch._instances.size() + count);
+    batch._members.reserve(batch._members.size() + count);
+}
+
+InstanceBatch &InstanceRenderer::_batchFor(const MeshHandle &resource)
+{
+    std::unique_ptr<InstanceBatch> &batch = _batches[resource.get()];
+    if (!batch)
+        batch.reset(new InstanceBatch{resource});
+    return *batch;
+}
+
+InstancedDrawable::InstancedDrawable(Object3D &object, InstanceRenderer &renderer, const CachedTransform &transform,
+                                     const MeshHandle &mesh, const Color4 &color, UnsignedInt objectId)
+    : SceneGraph::AbstractFeature3D{object}, _batch(renderer._batchFor(mesh)), _transform(transform)
+{
+    setCachedTransformations(SceneGraph::CachedTransformation::Absolute);
+
+    _batch._add(*this);
+    _batch._instances[_index].color = color;
+    _batch._instances[_index].objectId = objectId;
+}
+
+InstancedDrawable::~InstancedDrawable()
+{
+    _batch._remove(*this);
+}
+
+void InstancedDrawable::SetColor(const Color4 &color)
+{
+    _batch._instances[_index].color = color;
+    _batch._touch(_index);
+}
+
+void InstancedDrawable::clean(const Matrix4 &absoluteTransformationMatrix)
+{
+    InstanceData &instance = _batch._instances[_index];
+    instance.transformation = absoluteTransformationMatrix;
+    // Already cleaned, the transform comes first on the object
+    instance.normalMatrix = _transform.Normal();
+    _batch._touch(_index);
+
+    // Non-uniform scaling stretches the sphere by the largest axis scale
+    const MeshResource &mesh = *_batch._resource;
+    const Matrix3x3 scaling = absoluteTransformationMatrix.rotationScaling();
+    const Float scale = Math::sqrt(Math::max(Math::max(scaling[0].dot(), scaling[1].dot()), scaling[2].dot()));
+    const Vector3 center = absoluteTransformationMatrix.transformPoint(mesh.boundingCenter);
+    _batch._x[_index] = center.x();
+    _batch._y[_index] = center.y();
+    _batch._z[_index] = center.z();
+    _batch._radius[_index] = mesh.boundingRadius * scale;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/SceneGraph/AbstractFeature.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+#include <Magnum/SceneGraph/Object.h>
+#include <Magnum/Shaders/PhongGL.h>
+
+#include "MeshLibrary.h"
+#include "ObjectPool.h"
+#include "TransformCache.h"
+
+using Object3D = Magnum::SceneGraph::Object<Magnum::SceneGraph::MatrixTransformation3D>;
+
+class InstancedDrawable;
+
+// Per-instance attributes, in the order they are bound to the shader
+struct InstanceData
+{
+    Magnum::Matrix4 transformation;
+    Magnum::Matrix3x3 normalMatrix;
+    Magnum::Color4 color;
+    Magnum::UnsignedInt objectId;
+};
+
+// All instances of one shared mesh, drawn with a single instanced draw call. The instance
+// buffer is only touched when members are added, removed or moved, and then only the range
+// that changed is uploaded. When some instances are culled, the visible ones are copied into a
+// second buffer that is refilled every frame and drawn instead.
+class InstanceBatch
+{
+  public:
+    explicit InstanceBatch(MeshHandle resource);
+
+    std::size_t InstanceCount() const
+    {
+        return _instances.size();
+    }
+
+  private:
+    friend class InstanceRenderer;
+    friend InstancedDrawable;
+
+    void _add(InstancedDrawable &member);
+    void _remove(InstancedDrawable &member);
+    void _touch(std::size_t index);
+    void _resizeSpheres();
+
+    // Returns the number of bytes uploaded
+    std::size_t _upload();
+
+    MeshHandle _resource;
+    Magnum::GL::Mesh _mesh;
+    Magnum::GL::Buffer _instanceBuffer;
+    std::size_t _bufferCapacity = 0;
+
+    std::vector<InstanceData> _instances;
+    std::vector<InstancedDrawable *> _members;
+
+    // Range of _instances that differs from the GPU copy
+    std::size_t _dirtyBegin = 0;
+    std::size_t _dirtyEnd = 0;
+
+    // World bounding spheres of _instances, padded for SphereCulling
+    std::vector<Magnum::Float> _x, _y, _z, _radius;
+
+    Magnum::GL::Mesh _visibleMesh;
+    Magnum::GL::Buffer _visibleBuffer;
+    std::size_t _visibleCapacity = 0;
+};
+
+// Draws every object with an InstancedDrawable feature, batched by mesh. Moved objects are
+// written into their batch when TransformCache::Update() cleans them. Expects a PhongGL
+// shader created with Flag::InstancedTransformation, Flag::InstancedObjectId and
+// Flag::VertexColor, the instance color is multiplied with the shader's material colors.
+class InstanceRenderer
+{
+  public:
+    struct Stats
+    {
+        std::size_t batches = 0;
+        std::size_t instances = 0;
+        std::size_t bufferBytes = 0;
+
+        // Last frame only
+        std::size_t drawCalls = 0;
+        std::size_t uploadedBytes = 0;
+        std::size_t visible = 0;
+        std::size_t culled = 0;
+    };
+
+    InstanceRenderer() = default;
+
+    InstanceRenderer(const InstanceRenderer &) = delete;
+    InstanceRenderer &operator=(const InstanceRenderer &) = delete;
+
+    // Drops batches left without members. Draw() calls it as well, call it explicitly on frames
+    // where the instanced path is not drawn.
+    void Update();
+
+    void Draw(Magnum::Shaders::PhongGL &shader, Magnum::SceneGraph::Camera3D &camera);
+
+    // Makes room for this many more instances of the mesh, so the batch and its instance buffer
+    // grow once
+    void Reserve(const MeshHandle &mesh, std::size_t count);
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    // Draw only the instances of each batch whose bounding sphere is inside the frustum
+    bool culling = true;
+
+  private:
+    friend InstancedDrawable;
+
+    InstanceBatch &_batchFor(const MeshHandle &resource);
+
+    std::unordered_map<MeshResource *, std::unique_ptr<InstanceBatch>> _batches;
+    Stats _stats;
+
+    // Scratch space of the culling in Draw()
+    std::vector<Magnum::UnsignedByte> _visible;
+    std::vector<InstanceData> _visibleInstances;
+};
+
+// Makes an object part of an instanced batch. Attach it to the object that owns the mesh, after
+// the object's transform.
+class InstancedDrawable : public Magnum::SceneGraph::AbstractFeature3D, public Pooled
+{
+  public:
+    explicit InstancedDrawable(Object3D &object, InstanceRenderer &renderer, const CachedTransform &transform,
+                               const MeshHandle &mesh, const Magnum::Color4 &color, Magnum::UnsignedInt objectId);
+    ~InstancedDrawable();
+
+    void SetColor(const Magnum::Color4 &color);
+
+  private:
+    friend InstanceRenderer;
+    friend InstanceBatch;
+
+    void clean(const Magnum::Matrix4 &absoluteTransformationMatrix) override;
+
+    InstanceBatch &_batch;
+    const CachedTransform &_transform;
+
+    std::size_t _index = 0;
+};
@@ -0,0 +1,140 @@
+#include "MeshLibrary.h"
+
+#include <utility>
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Pair.h>
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/MeshTools/BoundingVolume.h>
+#include <Magnum/MeshTools/Compile.h>
+#include <Magnum/Primitives/Capsule.h>
+#include <Magnum/Primitives/Cone.h>
+#include <Magnum/Primitives/Cube.h>
+#include <Magnum/Primitives/Grid.h>
+#include <Magnum/Primitives/Icosphere.h>
+
+#include "RenderStats.h"
+
+using namespace Magnum;
+
+Trade::MeshData GeneratePrimitiveMesh(const PrimitiveMeshKey &key)
+{
+    const Vector3i &t = key.tessellation;
+    switch (key.type)
+    {
+    case PrimitiveType::Plane:
+        return Primitives::grid3DSolid(t.xy());
+    case PrimitiveType::Cube:
+        return Primitives::cubeSolid();
+    case PrimitiveType::Sphere:
+        return Primitives::icosphereSolid(t.x());
+    case PrimitiveType::Cone:
+        return Primitives::coneSolid(t.x(), t.y(), key.halfLength);
+    case PrimitiveType::Capsule:
+        return Primitives::capsule3DSolid(t.x(), t.y(), t.z(), key.halfLength);
+    }
+
+    CORRADE_INTERNAL_ASSERT_UNREACHABLE();
+}
+
+MeshResource::MeshResource(Trade::MeshData &&data) : data{std::move(data)}, bvh{this->data}
+{
+    vertices.setData(this->data.vertexData());
+    gpuBytes = this->data.vertexData().size();
+
+    if (this->data.isIndexed())
+    {
+        indices = GL::Buffer{GL::Buffer::TargetHint::ElementArray};
+        indices.setData(this->data.indexData());
+        gpuBytes += this->data.indexData().size();
+    }
+    RenderStats::Shared().Uploaded(gpuBytes);
+
+    mesh = CreateMesh();
+
+    const Containers::Pair<Vector3, Float> sphere =
+        MeshTools::boundingSphereBouncingBubble(this->data.positions3DAsArray());
+    boundingCenter = sphere.first();
+    boundingRadius = sphere.second();
+
+    const UnsignedInt count = this->data.isIndexed() ? this->data.indexCount() : this->data.vertexCount();
+    switch (this->data.primitive())
+    {
+    case MeshPrimitive::Triangles:
+        triangles = count / 3;
+        break;
+    case MeshPrimitive::TriangleStrip:
+    case MeshPrimitive::TriangleFan:
+        triangles = count > 2 ? count - 2 : 0;
+        break;
+    default:
+        break;
+    }
+}
+
+GL::Mesh MeshResource::CreateMesh()
+{
+    return MeshTools::compile(data, indices, vertices);
+}
+
+PrimitiveMeshKey PrimitiveMeshKey::Plane(const Vector2i &subdivisions)
+{
+    return {PrimitiveType::Plane, {subdivisions, 0}, 0.0f};
+}
+
+PrimitiveMeshKey PrimitiveMeshKey::Cube()
+{
+    return {PrimitiveType::Cube, {}, 0.0f};
+}
+
+PrimitiveMeshKey PrimitiveMeshKey::Sphere(UnsignedInt subdivisions)
+{
+    return {PrimitiveType::Sphere, {Int(subdivisions), 0, 0}, 0.0f};
+}
+
+PrimitiveMeshKey PrimitiveMeshKey::Cone(UnsignedInt rings, UnsignedInt segments, Float halfLength)
+{
+    return {PrimitiveType::Cone, {Int(rings), Int(segments), 0}, halfLength};
+}
+
+PrimitiveMeshKey PrimitiveMeshKey::Capsule(UnsignedInt hemisphereRings, UnsignedInt cylinderRings,
+                                           UnsignedInt segments, Float halfLength)
+{
+    return {PrimitiveType::Capsule, {Int(hemisphereRings), Int(cylinderRings), Int(segments)}, halfLength};
+}
+
+std::size_t PrimitiveMeshKeyHash::operator()(const PrimitiveMeshKey &key) const
+{
+    std::size_t hash = std::size_t(key.type);
+    for (Int value : {key.tessellation.x(), key.tessellation.y(), key.tessellation.z()})
+        hash = hash * 31 + std::hash<Int>{}(value);
+    return hash * 31 + std::hash<Float>{}(key.halfLength);
+}
+
+MeshHandle MeshLibrary::Get(const PrimitiveMeshKey &key)
+{
+    std::weak_ptr<MeshResource> &cached = _meshes[key];
+    if (MeshHandle handle = cached.lock())
+    {
+        ++_stats.hits;
+        return handle;
+    }
+
+    ++_stats.misses;
+
+    MeshHandle handle{new MeshResource{GeneratePrimitiveMesh(key)},
+                      [this, key](MeshResource *resource) {
+                          _stats.gpuBytes -= resource->gpuBytes;
+                          --_stats.liveMeshes;
+                          _meshes.erase(key);
+                          delete resource;
+                      }};
+
+    _stats.gpuBytes += handle->gpuBytes;
+    _stats.peakGpuBytes = Math::max(_stats.peakGpuBytes, _stats.gpuBytes);
+    ++_stats.liveMeshes;
+
+    cached = handle;
+    return handle;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/Math/Vector3.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "MeshBvh.h"
+
+enum class PrimitiveType : Magnum::UnsignedByte
+{
+    Plane,
+    Cube,
+    Sphere,
+    Cone,
+    Capsule
+};
+
+// Identifies a generated primitive mesh. The tessellation parameters follow the arguments of
+// the Primitives:: function generating the type, unused ones are zero.
+struct PrimitiveMeshKey
+{
+    PrimitiveType type;
+    Magnum::Vector3i tessellation;
+    Magnum::Float halfLength;
+
+    static PrimitiveMeshKey Plane(const Magnum::Vector2i &subdivisions = {10, 10});
+    static PrimitiveMeshKey Cube();
+    static PrimitiveMeshKey Sphere(Magnum::UnsignedInt subdivisions = 3);
+    static PrimitiveMeshKey Cone(Magnum::UnsignedInt rings = 10, Magnum::UnsignedInt segments = 16,
+                                 Magnum::Float halfLength = 1.0f);
+    static PrimitiveMeshKey Capsule(Magnum::UnsignedInt hemisphereRings = 10, Magnum::UnsignedInt cylinderRings = 10,
+                                    Magnum::UnsignedInt segments = 16, Magnum::Float halfLength = 0.5f);
+
+    bool operator==(const PrimitiveMeshKey &other) const
+    {
+        return type == other.type && tessellation == other.tessellation && halfLength == other.halfLength;
+    }
+};
+
+struct PrimitiveMeshKeyHash
+{
+    std::size_t operator()(const PrimitiveMeshKey &key) const;
+};
+
+// Generates the mesh of a primitive on the CPU, nothing is uploaded
+Magnum::Trade::MeshData GeneratePrimitiveMesh(const PrimitiveMeshKey &key);
+
+// Everything derived from one generated mesh, shared by all objects using it. The vertex and
+// index buffers are uploaded once, any number of meshes can be set up on top of them.
+class MeshResource
+{
+  public:
+    explicit MeshResource(Magnum::Trade::MeshData &&data);
+
+    // New mesh referencing the shared buffers, e.g. to add instanced attributes to
+    Magnum::GL::Mesh CreateMesh();
+
+    Magnum::Trade::MeshData data;
+    Magnum::GL::Buffer vertices;
+    Magnum::GL::Buffer indices{Corrade::NoCreate};
+    Magnum::GL::Mesh mesh{Corrade::NoCreate};
+    MeshBvh bvh;
+    std::size_t gpuBytes = 0;
+    std::size_t triangles = 0; // drawn by one instance
+
+    // Bounding sphere in mesh space
+    Magnum::Vector3 boundingCenter;
+    Magnum::Float boundingRadius = 0.0f;
+};
+
+using MeshHandle = std::shared_ptr<MeshResource>;
+
+// Generates and uploads every primitive mesh once and hands out shared handles to it. The GPU
+// memory is freed as soon as the last handle goes away, a later request uploads it again.
+class MeshLibrary
+{
+  public:
+    struct Stats
+    {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t liveMeshes = 0;
+        std::size_t gpuBytes = 0;
+        std::size_t peakGpuBytes = 0;
+    };
+
+    MeshLibrary() = default;
+
+    // Handles call back into the library when released, so it can't move
+    MeshLibrary(const MeshLibrary &) = delete;
+    MeshLibrary &operator=(const MeshLibrary &) = delete;
+
+    MeshHandle Get(const PrimitiveMeshKey &key);
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+  private:
+    std::unordered_map<PrimitiveMeshKey, std::weak_ptr<MeshResource>, PrimitiveMeshKeyHash> _meshes;
+    Stats _stats;
+};
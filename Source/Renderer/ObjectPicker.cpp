@@ -0,0 +1,67 @@
+#include "ObjectPicker.h"
+
+#include <Magnum/GL/BufferImage.h>
+#include <Magnum/GL/PixelFormat.h>
+
+using namespace Magnum;
+
+ObjectPicker::ObjectPicker(unsigned int ringSize) : _slots(ringSize)
+{
+}
+
+ObjectPicker::~ObjectPicker()
+{
+    for (Slot &slot : _slots)
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+}
+
+bool ObjectPicker::Request(GL::Framebuffer &framebuffer, const Vector2i &pixel, Kind kind, unsigned long long frame)
+{
+    Slot &slot = _slots[_next];
+    if (slot.fence)
+        return false;
+
+    // Buffers are created on first use so the picker can live in the application before
+    // the GL context exists
+    if (!slot.image.buffer().id())
+        slot.image = GL::BufferImage2D{GL::PixelFormat::RedInteger, GL::PixelType::UnsignedInt};
+
+    framebuffer.read(Range2Di::fromSize(pixel, Vector2i{1}), slot.image, GL::BufferUsage::StreamRead);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.kind = kind;
+    slot.frame = frame;
+
+    _next = (_next + 1) % _slots.size();
+    ++_pending;
+    return true;
+}
+
+std::vector<ObjectPicker::Result> &ObjectPicker::Poll()
+{
+    _results.clear();
+
+    // The oldest request sits right after the most recently written slot
+    for (unsigned int i = 0; i != _slots.size() && _pending; ++i)
+    {
+        Slot &slot = _slots[(_next + _slots.size() - _pending) % _slots.size()];
+
+        const GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        --_pending;
+
+        UnsignedInt id = 0;
+        const Containers::ArrayView<const char> data = slot.image.buffer().mapRead(0, sizeof(UnsignedInt));
+        if (data)
+            id = *reinterpret_cast<const UnsignedInt *>(data.data());
+        slot.image.buffer().unmap();
+
+        _results.push_back({id, slot.kind, slot.frame});
+    }
+
+    return _results;
+}
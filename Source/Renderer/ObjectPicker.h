@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+#include <Magnum/GL/BufferImage.h>
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/Math/Vector2.h>
+
+// Reads object IDs back from the GPU without stalling the pipeline. Each request copies a
+// single pixel into one of a ring of pixel pack buffers and puts a fence behind it. Results
+// are collected by Poll() once the fence has signaled, usually one or two frames later.
+class ObjectPicker
+{
+  public:
+    enum class Kind
+    {
+        Hover,
+        Click
+    };
+
+    struct Result
+    {
+        Magnum::UnsignedInt id;
+        Kind kind;
+        unsigned long long frame;
+    };
+
+    explicit ObjectPicker(unsigned int ringSize = 3);
+    ~ObjectPicker();
+
+    ObjectPicker(const ObjectPicker &) = delete;
+    ObjectPicker &operator=(const ObjectPicker &) = delete;
+
+    // Queues a read of an R32UI pixel from the current read attachment of the framebuffer.
+    // Returns false if all buffers of the ring are still in flight.
+    bool Request(Magnum::GL::Framebuffer &framebuffer, const Magnum::Vector2i &pixel, Kind kind,
+                 unsigned long long frame);
+
+    // Collects finished reads in request order, never blocks
+    std::vector<Result> &Poll();
+
+    unsigned int PendingCount() const
+    {
+        return _pending;
+    }
+
+  private:
+    struct Slot
+    {
+        Magnum::GL::BufferImage2D image{Corrade::NoCreate};
+        GLsync fence = nullptr;
+        Kind kind = Kind::Hover;
+        unsigned long long frame = 0;
+    };
+
+    std::vector<Slot> _slots;
+    std::vector<Result> _results;
+    unsigned int _next = 0;
+    unsigned int _pending = 0;
+};
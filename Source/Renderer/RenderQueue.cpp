@@ -0,0 +1,362 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <Corrade/Containers/ArrayViewStl.h>
+#include <Corrade/Containers/Reference.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Packing.h>
+
+#include "RenderStats.h"
+
+using namespace Magnum;
+
+namespace
+{
+
+// Key layout from the most significant bit: shader, mesh, material, depth
+constexpr UnsignedInt ShaderBits = 4;
+constexpr UnsignedInt MeshBits = 12;
+constexpr UnsignedInt MaterialBits = 24;
+constexpr UnsignedInt DepthBits = 24;
+
+// Uniforms the drawables used to set for every object
+constexpr std::size_t UniformsPerItem = 7;
+
+// Per-draw uniform buffer entries, all of them are the same size
+constexpr UnsignedInt UniformSize = sizeof(Shaders::TransformationUniform3D);
+static_assert(sizeof(Shaders::PhongDrawUniform) == UniformSize && sizeof(Shaders::PhongMaterialUniform) == UniformSize,
+              "uniform sizes differ");
+
+constexpr UnsignedInt MaxDrawsPerChunk = 256;
+
+UnsignedInt roundUp(UnsignedInt value, UnsignedInt multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+UnsignedLong materialBits(const PhongMaterial &material)
+{
+    const Color3ub color = Math::pack<Color3ub>(Math::clamp(material.diffuseColor.rgb(), 0.0f, 1.0f));
+    return (UnsignedLong(color.r()) << 16) | (UnsignedLong(color.g()) << 8) | color.b();
+}
+
+// Bit patterns of non-negative floats sort the same way as their values, the top bits are a
+// logarithmic quantization that keeps precision close to the camera
+UnsignedLong depthBits(Float depth)
+{
+    depth = Math::max(depth, 0.0f);
+    UnsignedInt bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return bits >> (32 - DepthBits - 1);
+}
+
+} // namespace
+
+void RenderQueue::Submit(Shaders::PhongGL &shader, GL::Mesh &mesh, const PhongMaterial &material,
+                         const Matrix4 &transformation, UnsignedInt objectId)
+{
+    const UnsignedLong key = (UnsignedLong(_shaderIndex(shader)) << (MeshBits + MaterialBits + DepthBits)) |
+                             (UnsignedLong(_meshIndex(mesh)) << (MaterialBits + DepthBits)) |
+                             (materialBits(material) << DepthBits) | depthBits(-transformation.translation().z());
+
+    _order.push_back({key, UnsignedInt(_items.size())});
+    _items.push_back({&shader, &mesh, material, transformation, objectId});
+}
+
+void RenderQueue::Flush(SceneGraph::Camera3D &camera)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    _stats = {};
+    _stats.items = _items.size();
+
+    std::sort(_order.begin(), _order.end(),
+              [](const SortEntry &a, const SortEntry &b) { return a.key < b.key; });
+
+    if (multiDraw)
+        _drawMultiDraw(camera);
+    else
+        _drawClassic(camera);
+
+    _items.clear();
+    _order.clear();
+
+    RenderStats::Shared().UniformsSet(_stats.uniformUploads);
+
+    _stats.submitMilliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RenderQueue::_drawClassic(SceneGraph::Camera3D &camera)
+{
+    // State of the shader currently in use. Everything is set again when the shader changes, as
+    // other code may have used it in between.
+    Shaders::PhongGL *shader = nullptr;
+    PhongMaterial material;
+    UnsignedInt objectId = 0;
+    bool hasObjectId = false;
+
+    const Matrix4 &projection = camera.projectionMatrix();
+    std::size_t naiveUploads = 0;
+
+    for (const SortEntry &entry : _order)
+    {
+        const Item &item = _items[entry.item];
+
+        if (item.shader != shader)
+        {
+            shader = item.shader;
+            material = item.material;
+            objectId = item.objectId;
+            hasObjectId = bool(shader->flags() & Shaders::PhongGL::Flag::ObjectId);
+
+            shader->setProjectionMatrix(projection)
+                .setLightPositions(Containers::arrayView(lightPositions))
+                .setAmbientColor(material.ambientColor)
+                .setDiffuseColor(material.diffuseColor)
+                .setShininess(material.shininess);
+            _stats.uniformUploads += 5;
+
+            // Not pickable objects must not inherit the ID of whatever was drawn before
+            if (hasObjectId)
+            {
+                shader->setObjectId(objectId);
+                ++_stats.uniformUploads;
+            }
+        }
+        else
+        {
+            if (item.material.ambientColor != material.ambientColor)
+            {
+                shader->setAmbientColor(item.material.ambientColor);
+                ++_stats.uniformUploads;
+            }
+            if (item.material.diffuseColor != material.diffuseColor)
+            {
+                shader->setDiffuseColor(item.material.diffuseColor);
+                ++_stats.uniformUploads;
+            }
+            if (item.material.shininess != material.shininess)
+            {
+                shader->setShininess(item.material.shininess);
+                ++_stats.uniformUploads;
+            }
+            material = item.material;
+
+            if (hasObjectId && item.objectId != objectId)
+            {
+                shader->setObjectId(item.objectId);
+                objectId = item.objectId;
+                ++_stats.uniformUploads;
+            }
+        }
+
+        shader->setTransformationMatrix(item.transformation)
+            .setNormalMatrix(item.transformation.normalMatrix())
+            .draw(*item.mesh);
+        _stats.uniformUploads += 2;
+        ++_stats.drawCalls;
+        RenderStats::Shared().Draw(shader, *item.mesh);
+
+        naiveUploads += UniformsPerItem + (hasObjectId ? 1 : 0);
+    }
+
+    _stats.uniformUploadsSkipped = naiveUploads - _stats.uniformUploads;
+}
+
+void RenderQueue::_drawMultiDraw(SceneGraph::Camera3D &camera)
+{
+    if (_order.empty())
+        return;
+
+    if (!_chunkSize)
+    {
+        // Every chunk is bound as a range, which has to fit into a uniform block and start at
+        // an aligned offset
+        const UnsignedInt maxDraws = UnsignedInt(GL::AbstractShaderProgram::maxUniformBlockSize()) / UniformSize;
+        _chunkSize = Math::min(MaxDrawsPerChunk, maxDraws);
+        _chunkStride = roundUp(_chunkSize * UniformSize, UnsignedInt(GL::Buffer::uniformOffsetAlignment())) /
+                       UniformSize;
+
+        _projectionBuffer = GL::Buffer{GL::Buffer::TargetHint::Uniform};
+        _lightBuffer = GL::Buffer{GL::Buffer::TargetHint::Uniform};
+        _transformationBuffer = GL::Buffer{GL::Buffer::TargetHint::Uniform};
+        _drawBuffer = GL::Buffer{GL::Buffer::TargetHint::Uniform};
+        _materialBuffer = GL::Buffer{GL::Buffer::TargetHint::Uniform};
+    }
+
+    // Split the sorted draws into runs sharing a shader and a mesh
+    _chunkStarts.clear();
+    for (std::size_t i = 0; i != _order.size(); ++i)
+    {
+        const Item &item = _items[_order[i].item];
+        if (_chunkStarts.empty() || i - _chunkStarts.back() == _chunkSize)
+        {
+            _chunkStarts.push_back(UnsignedInt(i));
+            continue;
+        }
+
+        const Item &first = _items[_order[_chunkStarts.back()].item];
+        if (item.shader != first.shader || item.mesh != first.mesh)
+            _chunkStarts.push_back(UnsignedInt(i));
+    }
+    const std::size_t chunkCount = _chunkStarts.size();
+    _chunkStarts.push_back(UnsignedInt(_order.size()));
+
+    _transformationUniforms.resize(chunkCount * _chunkStride);
+    _drawUniforms.resize(chunkCount * _chunkStride);
+    _materialUniforms.resize(chunkCount * _chunkStride);
+
+    for (std::size_t chunk = 0; chunk != chunkCount; ++chunk)
+    {
+        const std::size_t offset = chunk * _chunkStride;
+        UnsignedInt materialCount = 0;
+        const PhongMaterial *material = nullptr;
+
+        for (UnsignedInt i = _chunkStarts[chunk]; i != _chunkStarts[chunk + 1]; ++i)
+        {
+            const Item &item = _items[_order[i].item];
+            const std::size_t index = offset + i - _chunkStarts[chunk];
+
+            // Draws are sorted by material, so equal materials are next to each other
+            if (!material || item.material.ambientColor != material->ambientColor ||
+                item.material.diffuseColor != material->diffuseColor ||
+                item.material.shininess != material->shininess)
+            {
+                material = &item.material;
+                _materialUniforms[offset + materialCount++]
+                    .setAmbientColor(material->ambientColor)
+                    .setDiffuseColor(material->diffuseColor)
+                    .setShininess(material->shininess);
+            }
+
+            _transformationUniforms[index].setTransformationMatrix(item.transformation);
+            _drawUniforms[index]
+                .setNormalMatrix(item.transformation.normalMatrix())
+                .setMaterialId(materialCount - 1)
+                .setObjectId(item.objectId);
+        }
+    }
+
+    // Buffers are kept across frames and only reallocated when they grow
+    RenderStats &renderStats = RenderStats::Shared();
+    const auto upload = [&](GL::Buffer &buffer, Containers::ArrayView<const void> data) {
+        if (chunkCount > _bufferChunks)
+            buffer.setData(data, GL::BufferUsage::DynamicDraw);
+        else
+            buffer.setSubData(0, data);
+        renderStats.Uploaded(data.size());
+    };
+    upload(_transformationBuffer, Containers::arrayView(_transformationUniforms));
+    upload(_drawBuffer, Containers::arrayView(_drawUniforms));
+    upload(_materialBuffer, Containers::arrayView(_materialUniforms));
+    _bufferChunks = Math::max(_bufferChunks, chunkCount);
+
+    _projectionBuffer.setData({Shaders::ProjectionUniform3D{}.setProjectionMatrix(camera.projectionMatrix())},
+                              GL::BufferUsage::DynamicDraw);
+
+    std::vector<Shaders::PhongLightUniform> lights(lightPositions.size());
+    for (std::size_t i = 0; i != lights.size(); ++i)
+        lights[i].setPosition(lightPositions[i]);
+    _lightBuffer.setData(Containers::arrayView(lights), GL::BufferUsage::DynamicDraw);
+    renderStats.Uploaded(sizeof(Shaders::ProjectionUniform3D) + lights.size() * sizeof(Shaders::PhongLightUniform));
+
+    _stats.uniformUploads = 5;
+
+    const bool multiDrawSupported =
+        GL::Context::current().isExtensionSupported<GL::Extensions::ARB::shader_draw_parameters>();
+
+    Shaders::PhongGL *shader = nullptr;
+    std::size_t naiveUploads = 0;
+    for (std::size_t chunk = 0; chunk != chunkCount; ++chunk)
+    {
+        const Item &first = _items[_order[_chunkStarts[chunk]].item];
+        Shaders::PhongGL &chunkShader = _multiDrawShader(*first.shader);
+        if (&chunkShader != shader)
+        {
+            shader = &chunkShader;
+            shader->bindProjectionBuffer(_projectionBuffer).bindLightBuffer(_lightBuffer);
+        }
+
+        const GLintptr offset = GLintptr(chunk) * _chunkStride * UniformSize;
+        const GLsizeiptr size = GLsizeiptr(_chunkSize) * UniformSize;
+        shader->bindTransformationBuffer(_transformationBuffer, offset, size)
+            .bindDrawBuffer(_drawBuffer, offset, size)
+            .bindMaterialBuffer(_materialBuffer, offset, size);
+
+        _views.clear();
+        for (UnsignedInt i = _chunkStarts[chunk]; i != _chunkStarts[chunk + 1]; ++i)
+        {
+            _views.emplace_back(*first.mesh);
+            _views.back().setCount(first.mesh->count());
+        }
+
+        // Without shader draw parameters the draw ID has to come from the draw offset instead
+        if (multiDrawSupported)
+        {
+            _viewReferences.assign(_views.begin(), _views.end());
+            shader->draw(Containers::arrayView(_viewReferences));
+            ++_stats.drawCalls;
+            renderStats.Draw(shader, *first.mesh, _views.size());
+        }
+        else
+        {
+            for (std::size_t i = 0; i != _views.size(); ++i)
+            {
+                shader->setDrawOffset(UnsignedInt(i)).draw(_views[i]);
+                ++_stats.drawCalls;
+                renderStats.UniformsSet();
+                renderStats.Draw(shader, *first.mesh);
+            }
+        }
+
+        const bool hasObjectId = bool(first.shader->flags() & Shaders::PhongGL::Flag::ObjectId);
+        naiveUploads += _views.size() * (UniformsPerItem + (hasObjectId ? 1 : 0));
+    }
+
+    _stats.uniformUploadsSkipped = naiveUploads > _stats.uniformUploads ? naiveUploads - _stats.uniformUploads : 0;
+}
+
+Shaders::PhongGL &RenderQueue::_multiDrawShader(const Shaders::PhongGL &shader)
+{
+    Shaders::PhongGL::Flags flags = shader.flags() | Shaders::PhongGL::Flag::UniformBuffers;
+    if (GL::Context::current().isExtensionSupported<GL::Extensions::ARB::shader_draw_parameters>())
+        flags |= Shaders::PhongGL::Flag::MultiDraw;
+    const UnsignedInt lightCount = UnsignedInt(lightPositions.size());
+
+    for (const std::unique_ptr<MultiDrawShader> &variant : _multiDrawShaders)
+        if (variant->flags == flags && variant->lightCount == lightCount)
+            return variant->shader;
+
+    _multiDrawShaders.emplace_back(new MultiDrawShader{
+        flags, lightCount, Shaders::PhongGL{flags, lightCount, _chunkSize, _chunkSize}});
+    return _multiDrawShaders.back()->shader;
+}
+
+UnsignedInt RenderQueue::_shaderIndex(Shaders::PhongGL &shader)
+{
+    auto found = std::find(_shaders.begin(), _shaders.end(), &shader);
+    if (found != _shaders.end())
+        return UnsignedInt(found - _shaders.begin());
+
+    // Shaders past the key range share the last index and just sort less well
+    if (_shaders.size() == (1u << ShaderBits) - 1)
+        return (1u << ShaderBits) - 1;
+
+    _shaders.push_back(&shader);
+    return UnsignedInt(_shaders.size() - 1);
+}
+
+UnsignedInt RenderQueue::_meshIndex(GL::Mesh &mesh)
+{
+    // Meshes come and go, start over once the key range is used up
+    if (_meshes.size() == (1u << MeshBits))
+        _meshes.clear();
+
+    return _meshes.emplace(&mesh, UnsignedInt(_meshes.size())).first->second;
+}
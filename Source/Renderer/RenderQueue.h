@@ -0,0 +1,127 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <Corrade/Containers/Reference.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/MeshView.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/Shaders/Generic.h>
+#include <Magnum/Shaders/Phong.h>
+#include <Magnum/Shaders/PhongGL.h>
+
+struct PhongMaterial
+{
+    // 0x111111_rgbf
+    Magnum::Color4 ambientColor{Magnum::Color3{0x11 / 255.0f}};
+    Magnum::Color4 diffuseColor{1.0f};
+    Magnum::Float shininess = 80.0f;
+};
+
+// Collects Phong draws of a pass and submits them sorted by a 64-bit key made of shader, mesh,
+// material and depth, so that consecutive draws share as much state as possible. Uniforms that
+// are the same for the whole pass are set once per shader, per-object ones only when they
+// differ from what the shader already has.
+//
+// With multiDraw enabled the same draws go through a uniform buffer variant of each shader
+// instead. Per-draw transformation, normal matrix and material are written into buffers indexed
+// by draw ID and every run of draws sharing a mesh is submitted with one multi-draw call.
+class RenderQueue
+{
+  public:
+    struct Stats
+    {
+        // Last flush only
+        std::size_t items = 0;
+        std::size_t uniformUploads = 0;
+        std::size_t uniformUploadsSkipped = 0;
+        std::size_t drawCalls = 0;
+        double submitMilliseconds = 0.0;
+    };
+
+    RenderQueue() = default;
+
+    RenderQueue(const RenderQueue &) = delete;
+    RenderQueue &operator=(const RenderQueue &) = delete;
+
+    // Transformation is relative to the camera, as passed to Drawable::draw()
+    void Submit(Magnum::Shaders::PhongGL &shader, Magnum::GL::Mesh &mesh, const PhongMaterial &material,
+                const Magnum::Matrix4 &transformation, Magnum::UnsignedInt objectId = 0);
+
+    // Draws and clears everything submitted since the last flush
+    void Flush(Magnum::SceneGraph::Camera3D &camera);
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    // Same for all shaders and the whole pass
+    std::vector<Magnum::Vector4> lightPositions{{3.0f, 3.0f, 3.0f, 0.0f}};
+
+    // Submit through uniform buffers and multi-draw instead of per-draw uniforms
+    bool multiDraw = false;
+
+  private:
+    struct Item
+    {
+        Magnum::Shaders::PhongGL *shader;
+        Magnum::GL::Mesh *mesh;
+        PhongMaterial material;
+        Magnum::Matrix4 transformation;
+        Magnum::UnsignedInt objectId;
+    };
+
+    struct SortEntry
+    {
+        Magnum::UnsignedLong key;
+        Magnum::UnsignedInt item;
+    };
+
+    // Uniform buffer variant of a submitted shader
+    struct MultiDrawShader
+    {
+        Magnum::Shaders::PhongGL::Flags flags;
+        Magnum::UnsignedInt lightCount;
+        Magnum::Shaders::PhongGL shader;
+    };
+
+    Magnum::UnsignedInt _shaderIndex(Magnum::Shaders::PhongGL &shader);
+    Magnum::UnsignedInt _meshIndex(Magnum::GL::Mesh &mesh);
+
+    void _drawClassic(Magnum::SceneGraph::Camera3D &camera);
+    void _drawMultiDraw(Magnum::SceneGraph::Camera3D &camera);
+    Magnum::Shaders::PhongGL &_multiDrawShader(const Magnum::Shaders::PhongGL &shader);
+
+    std::vector<Item> _items;
+    std::vector<SortEntry> _order;
+
+    // Multi-draw state. Draws are split into chunks of at most _chunkSize sharing a shader and
+    // a mesh; every chunk owns an aligned slice of each buffer so it can be bound as a range.
+    std::vector<std::unique_ptr<MultiDrawShader>> _multiDrawShaders;
+    Magnum::UnsignedInt _chunkSize = 0;
+    Magnum::UnsignedInt _chunkStride = 0;
+    Magnum::GL::Buffer _projectionBuffer{Corrade::NoCreate};
+    Magnum::GL::Buffer _lightBuffer{Corrade::NoCreate};
+    Magnum::GL::Buffer _transformationBuffer{Corrade::NoCreate};
+    Magnum::GL::Buffer _drawBuffer{Corrade::NoCreate};
+    Magnum::GL::Buffer _materialBuffer{Corrade::NoCreate};
+    std::size_t _bufferChunks = 0;
+    std::vector<Magnum::Shaders::TransformationUniform3D> _transformationUniforms;
+    std::vector<Magnum::Shaders::PhongDrawUniform> _drawUniforms;
+    std::vector<Magnum::Shaders::PhongMaterialUniform> _materialUniforms;
+    std::vector<Magnum::UnsignedInt> _chunkStarts;
+    std::vector<Magnum::GL::MeshView> _views;
+    std::vector<Corrade::Containers::Reference<Magnum::GL::MeshView>> _viewReferences;
+
+    // Only used to order the keys, not for correctness
+    std::vector<Magnum::Shaders::PhongGL *> _shaders;
+    std::unordered_map<Magnum::GL::Mesh *, Magnum::UnsignedInt> _meshes;
+
+    Stats _stats;
+};
@@ -0,0 +1,60 @@
+#include "RenderStats.h"
+
+#include <Magnum/GL/Mesh.h>
+
+using namespace Magnum;
+
+namespace
+{
+
+std::size_t trianglesOf(GL::MeshPrimitive primitive, std::size_t count)
+{
+    switch (primitive)
+    {
+    case GL::MeshPrimitive::Triangles:
+        return count / 3;
+    case GL::MeshPrimitive::TriangleStrip:
+    case GL::MeshPrimitive::TriangleFan:
+        return count > 2 ? count - 2 : 0;
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+RenderStats &RenderStats::Shared()
+{
+    static RenderStats stats;
+    return stats;
+}
+
+void RenderStats::BeginFrame()
+{
+    _stats = _current;
+    _current = {};
+    _shader = nullptr;
+}
+
+void RenderStats::Draw(const void *shader, const GL::Mesh &mesh)
+{
+    // Meshes draw one instance by default. Magnum skips the draw, shader bind included, when
+    // there are no instances or no vertices.
+    if (mesh.count() && mesh.instanceCount())
+        Draw(shader, mesh, std::size_t(mesh.instanceCount()));
+}
+
+void RenderStats::Draw(const void *shader, const GL::Mesh &mesh, std::size_t count)
+{
+    if (shader != _shader)
+    {
+        _shader = shader;
+        ++_current.shaderBinds;
+    }
+
+    const std::size_t vertices = std::size_t(mesh.count()) * count;
+    ++_current.drawCalls;
+    _current.instances += count;
+    _current.vertices += vertices;
+    _current.triangles += trianglesOf(mesh.primitive(), mesh.count()) * count;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+
+#include <Magnum/GL/GL.h>
+#include <Magnum/GL/Renderer.h>
+
+// Counts what the engine asks the GL to do in a frame. Every draw, upload and state change made
+// by engine code goes through one of the counting calls below; GL calls made inside Magnum or
+// ImGui can't be seen and are reported by their callers as a whole. Shader binds are counted
+// the way Magnum's state tracker issues them, when a draw uses another shader than the last
+// one. Not thread-safe, GL work only happens on the main thread anyway.
+class RenderStats
+{
+  public:
+    struct Stats
+    {
+        std::size_t drawCalls = 0;
+        std::size_t instances = 0; // objects drawn, several per instanced or multi-draw call
+        std::size_t triangles = 0;
+        std::size_t vertices = 0; // vertex shader invocations, indices for indexed meshes
+        std::size_t shaderBinds = 0;
+        std::size_t uniformSets = 0;
+        std::size_t textureBinds = 0;
+        std::size_t uploadedBytes = 0;
+        std::size_t framebuffersCreated = 0;
+        std::size_t stateChanges = 0; // GL::Renderer feature toggles
+    };
+
+    // The counters all renderers and drawables report to
+    static RenderStats &Shared();
+
+    RenderStats() = default;
+
+    RenderStats(const RenderStats &) = delete;
+    RenderStats &operator=(const RenderStats &) = delete;
+
+    // Publishes the counters of the frame that just ended
+    void BeginFrame();
+
+    // One draw call of the whole mesh, as many times as its instance count says. Nothing is
+    // counted when the instance or vertex count is zero, Magnum doesn't draw then.
+    void Draw(const void *shader, const Magnum::GL::Mesh &mesh);
+
+    // One call drawing count copies of the mesh, e.g. a multi-draw
+    void Draw(const void *shader, const Magnum::GL::Mesh &mesh, std::size_t count);
+
+    // Draw calls made by code that can't be instrumented, e.g. the ImGui renderer
+    void ExternalDraws(std::size_t drawCalls, std::size_t triangles, std::size_t vertices)
+    {
+        _current.drawCalls += drawCalls;
+        _current.instances += drawCalls;
+        _current.triangles += triangles;
+        _current.vertices += vertices;
+    }
+
+    void UniformsSet(std::size_t count = 1)
+    {
+        _current.uniformSets += count;
+    }
+
+    void TexturesBound(std::size_t count = 1)
+    {
+        _current.textureBinds += count;
+    }
+
+    void Uploaded(std::size_t bytes)
+    {
+        _current.uploadedBytes += bytes;
+    }
+
+    void FramebuffersCreated(std::size_t count = 1)
+    {
+        _current.framebuffersCreated += count;
+    }
+
+    // Same as GL::Renderer::setFeature()
+    void SetFeature(Magnum::GL::Renderer::Feature feature, bool enabled)
+    {
+        Magnum::GL::Renderer::setFeature(feature, enabled);
+        ++_current.stateChanges;
+    }
+
+    // Code drawing with its own shaders, e.g. ImGui, leaves another shader bound
+    void ForgetShader()
+    {
+        _shader = nullptr;
+    }
+
+    // Counters of the last full frame
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+  private:
+    Stats _stats;
+
+    // Counted since the last BeginFrame()
+    Stats _current;
+    const void *_shader = nullptr;
+};
@@ -0,0 +1,165 @@
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+
+#include <Magnum/GL/AbstractTexture.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/Math/Functions.h>
+
+#include "RenderStats.h"
+
+using namespace Magnum;
+
+namespace
+{
+
+// Capacities are rounded to this granularity so small drags reuse the same target
+constexpr Int CapacityGranularity = 64;
+
+Int roundUp(Int value, Int multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+GL::TextureFormat resolvedFormat(GL::RenderbufferFormat format)
+{
+    switch (format)
+    {
+    case GL::RenderbufferFormat::RGBA16F:
+        return GL::TextureFormat::RGBA16F;
+    case GL::RenderbufferFormat::SRGB8Alpha8:
+        return GL::TextureFormat::SRGB8Alpha8;
+    default:
+        return GL::TextureFormat::RGBA8;
+    }
+}
+
+} // namespace
+
+RenderTarget::RenderTarget(const RenderTargetKey &key) : key{key}, size{key.capacity}
+{
+    // All attachments need the same sample count and integer formats may support fewer samples
+    const Int samples = Math::min(key.samples, GL::AbstractTexture::maxIntegerSamples());
+
+    color.setStorageMultisample(samples, key.colorFormat, key.capacity);
+    objectId.setStorageMultisample(samples, GL::RenderbufferFormat::R32UI, key.capacity);
+    depthStencil.setStorageMultisample(samples, GL::RenderbufferFormat::Depth24Stencil8, key.capacity);
+
+    framebufferMSAA = GL::Framebuffer{{{}, key.capacity}};
+    framebufferMSAA.attachRenderbuffer(GL::Framebuffer::ColorAttachment{0}, color);
+    framebufferMSAA.attachRenderbuffer(GL::Framebuffer::ColorAttachment{1}, objectId);
+    framebufferMSAA.attachRenderbuffer(GL::Framebuffer::BufferAttachment::DepthStencil, depthStencil);
+
+    objectIdResolved.setStorage(GL::RenderbufferFormat::R32UI, key.capacity);
+    framebufferObjectId = GL::Framebuffer{{{}, key.capacity}};
+    framebufferObjectId.attachRenderbuffer(GL::Framebuffer::ColorAttachment{0}, objectIdResolved);
+
+    colorTex.setStorage(1, resolvedFormat(key.colorFormat), key.capacity);
+
+    framebufferProxy = GL::Framebuffer{{{}, key.capacity}};
+    framebufferProxy.attachTexture(GL::Framebuffer::ColorAttachment{0}, colorTex, 0);
+
+    RenderStats::Shared().FramebuffersCreated(3);
+}
+
+void RenderTarget::SetSize(const Vector2i &size)
+{
+    this->size = size;
+
+    // Only the sub-rectangle gets rendered into, blitted and displayed
+    framebufferMSAA.setViewport({{}, size});
+    framebufferProxy.setViewport({{}, size});
+    framebufferObjectId.setViewport({{}, size});
+}
+
+Range2D RenderTarget::UvRange() const
+{
+    return {{}, Vector2{size} / Vector2{key.capacity}};
+}
+
+void RenderTargetPool::BeginFrame()
+{
+    ++_frame;
+
+    // Free targets that have not been used for a while, but always keep the most recently used
+    // one so that there's something to reuse once rendering resumes
+    if (_targets.empty())
+        return;
+    const RenderTarget *newest =
+        std::max_element(_targets.begin(), _targets.end(),
+                         [](const std::unique_ptr<RenderTarget> &a, const std::unique_ptr<RenderTarget> &b) {
+                             return a->lastUsedFrame < b->lastUsedFrame;
+                         })
+            ->get();
+    const auto stale = [this, newest](const std::unique_ptr<RenderTarget> &target) {
+        return target.get() != newest && _frame - target->lastUsedFrame > evictFrames;
+    };
+    _targets.erase(std::remove_if(_targets.begin(), _targets.end(), stale), _targets.end());
+}
+
+RenderTarget &RenderTargetPool::Acquire(const Vector2i &requestedSize, GL::RenderbufferFormat colorFormat,
+                                        Int samples)
+{
+    // Collapsed ImGui windows report an empty content region
+    const Vector2i size = Math::max(requestedSize, Vector2i{1});
+
+    if (size != _lastRequestedSize)
+    {
+        // The very first request is not a resize
+        _resizeSeen = _lastRequestedSize != Vector2i{};
+        _lastResizeFrame = _frame;
+        _lastRequestedSize = size;
+    }
+    const bool resizing = IsResizing();
+
+    // While resizing any target that fits will do, pick the smallest. Otherwise only a tight fit
+    // is accepted so that the memory of an oversized target is given back once the drag ends.
+    RenderTarget *best = nullptr;
+    for (auto &target : _targets)
+    {
+        const RenderTargetKey &key = target->key;
+        if (key.colorFormat != colorFormat || key.samples != samples)
+            continue;
+
+        const bool fits = (key.capacity >= size).all();
+        const bool tight = key.capacity == _capacityFor(size);
+        if (!fits || (!resizing && !tight))
+            continue;
+
+        if (!best || key.capacity.product() < best->key.capacity.product())
+            best = target.get();
+    }
+
+    if (!best)
+    {
+        Vector2i capacity = _capacityFor(size);
+        if (resizing)
+            capacity = _capacityFor(Vector2i{Vector2{size} * resizeHeadroom});
+        capacity = Math::min(capacity, Vector2i{GL::Renderbuffer::maxSize()});
+
+        _targets.emplace_back(new RenderTarget{RenderTargetKey{capacity, colorFormat, samples}});
+        best = _targets.back().get();
+        ++_allocationCount;
+    }
+
+    best->lastUsedFrame = _frame;
+    if (best->size != size)
+        best->SetSize(size);
+
+    return *best;
+}
+
+void RenderTargetPool::Clear()
+{
+    _targets.clear();
+}
+
+bool RenderTargetPool::IsResizing() const
+{
+    return _resizeSeen && _frame - _lastResizeFrame < settleFrames;
+}
+
+Vector2i RenderTargetPool::_capacityFor(const Vector2i &size) const
+{
+    return {roundUp(size.x(), CapacityGranularity), roundUp(size.y(), CapacityGranularity)};
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <Magnum/GL/Framebuffer.h>
+#include <Magnum/GL/Renderbuffer.h>
+#include <Magnum/GL/RenderbufferFormat.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Math/Vector2.h>
+
+// Identifies a set of attachments. The size is the allocated capacity, which may be
+// bigger than what is rendered into while the viewport is being resized.
+struct RenderTargetKey
+{
+    Magnum::Vector2i capacity;
+    Magnum::GL::RenderbufferFormat colorFormat;
+    Magnum::Int samples;
+
+    bool operator==(const RenderTargetKey &other) const
+    {
+        return capacity == other.capacity && colorFormat == other.colorFormat && samples == other.samples;
+    }
+};
+
+// Multisampled scene buffer plus the single-sampled proxy texture it is resolved into. The
+// scene buffer also carries a 32-bit object ID attachment, resolved on demand for picking.
+class RenderTarget
+{
+  public:
+    explicit RenderTarget(const RenderTargetKey &key);
+
+    // Sets the active sub-rectangle, must fit into the capacity
+    void SetSize(const Magnum::Vector2i &size);
+
+    // Texture coordinates of the active sub-rectangle on colorTex
+    Magnum::Range2D UvRange() const;
+
+    RenderTargetKey key;
+    Magnum::Vector2i size;
+    unsigned long long lastUsedFrame = 0;
+
+    Magnum::GL::Renderbuffer color;
+    Magnum::GL::Renderbuffer objectId;
+    Magnum::GL::Renderbuffer depthStencil;
+    Magnum::GL::Framebuffer framebufferMSAA{Corrade::NoCreate};
+
+    Magnum::GL::Renderbuffer objectIdResolved;
+    Magnum::GL::Framebuffer framebufferObjectId{Corrade::NoCreate};
+
+    Magnum::GL::Texture2D colorTex;
+    Magnum::GL::Framebuffer framebufferProxy{Corrade::NoCreate};
+};
+
+// Keeps render targets alive across frames and hands out one that fits the requested size.
+// Attachments are only reallocated when the size really changes. While the size keeps changing
+// (e.g. the viewport window is being dragged) targets are over-allocated so that consecutive
+// frames can render into a sub-rectangle of the same attachments. Once the size settles, a
+// tightly fitting target replaces the oversized one and unused targets are evicted.
+class RenderTargetPool
+{
+  public:
+    RenderTargetPool() = default;
+
+    RenderTargetPool(const RenderTargetPool &) = delete;
+    RenderTargetPool &operator=(const RenderTargetPool &) = delete;
+
+    // Call once per frame before acquiring targets
+    void BeginFrame();
+
+    RenderTarget &Acquire(const Magnum::Vector2i &size, Magnum::GL::RenderbufferFormat colorFormat,
+                          Magnum::Int samples);
+
+    // Drops all targets, e.g. when the context is about to go away
+    void Clear();
+
+    bool IsResizing() const;
+
+    std::size_t TargetCount() const
+    {
+        return _targets.size();
+    }
+
+    // Total number of attachment sets created so far
+    unsigned int AllocationCount() const
+    {
+        return _allocationCount;
+    }
+
+    // Frames the size has to stay the same before the resize is considered finished
+    unsigned int settleFrames = 30;
+
+    // Frames an unused target is kept around before being freed
+    unsigned int evictFrames = 120;
+
+    // Over-allocation factor used while resizing
+    float resizeHeadroom = 1.5f;
+
+  private:
+    Magnum::Vector2i _capacityFor(const Magnum::Vector2i &size) const;
+
+    std::vector<std::unique_ptr<RenderTarget>> _targets;
+
+    unsigned long long _frame = 0;
+    unsigned long long _lastResizeFrame = 0;
+    Magnum::Vector2i _lastRequestedSize;
+    bool _resizeSeen = false;
+    unsigned int _allocationCount = 0;
+};
@@ -0,0 +1,81 @@
+#include "SceneStoreRenderer.h"
+
+#include <algorithm>
+
+#include <Corrade/Containers/ArrayViewStl.h>
+
+#include "RenderStats.h"
+
+using namespace Magnum;
+
+SceneStoreRenderer::Batch::Batch(MeshResource &resource) : mesh{resource.CreateMesh()}, triangles{resource.triangles}
+{
+    mesh.addVertexBufferInstanced(instanceBuffer, 1, 0, Shaders::PhongGL::TransformationMatrix{},
+                                  Shaders::PhongGL::NormalMatrix{}, Shaders::PhongGL::Color4{},
+                                  Shaders::PhongGL::ObjectId{});
+}
+
+void SceneStoreRenderer::Prepare(SceneStore &store, const Matrix4 &projectionCamera)
+{
+    SceneSnapshot &snapshot = _snapshots[1 - _front];
+    store.Update();
+    store.Extract(projectionCamera, snapshot.instances);
+
+    // Meshes are only ever added to the store
+    if (snapshot.meshes.size() != store.Meshes().size())
+        snapshot.meshes = store.Meshes();
+    snapshot.store = store.Statistics();
+}
+
+void SceneStoreRenderer::Present()
+{
+    _front = 1 - _front;
+    ++_presented;
+}
+
+void SceneStoreRenderer::Draw(Shaders::PhongGL &shader, SceneGraph::Camera3D &camera)
+{
+    // Makes sure the camera matrix is up to date
+    camera.object().setClean();
+    const Matrix4 cameraMatrix = camera.cameraMatrix();
+
+    // Instance transformations are absolute, the uniform matrices take them to camera space
+    shader.setTransformationMatrix(cameraMatrix)
+        .setNormalMatrix(cameraMatrix.normalMatrix())
+        .setProjectionMatrix(camera.projectionMatrix())
+        .setObjectId(0);
+    RenderStats &renderStats = RenderStats::Shared();
+    renderStats.UniformsSet(4);
+
+    const SceneSnapshot &snapshot = _snapshots[_front];
+    _stats = {};
+    _batches.resize(std::max(_batches.size(), snapshot.meshes.size()));
+    for (std::size_t i = 0; i != snapshot.instances.size(); ++i)
+    {
+        const std::vector<InstanceData> &instances = snapshot.instances[i];
+        if (instances.empty())
+            continue;
+
+        std::unique_ptr<Batch> &batch = _batches[i];
+        if (!batch)
+            batch.reset(new Batch{*snapshot.meshes[i]});
+
+        // Grow along with the vector, the contents are replaced every frame anyway
+        if (instances.size() > batch->bufferCapacity)
+        {
+            batch->bufferCapacity = instances.capacity();
+            batch->instanceBuffer.setData({nullptr, batch->bufferCapacity * sizeof(InstanceData)},
+                                          GL::BufferUsage::StreamDraw);
+        }
+        batch->instanceBuffer.setSubData(0, Containers::arrayView(instances));
+        batch->mesh.setInstanceCount(Int(instances.size()));
+
+        shader.draw(batch->mesh);
+        ++_stats.drawCalls;
+        _stats.instances += instances.size();
+        _stats.triangles += instances.size() * batch->triangles;
+        _stats.uploadedBytes += instances.size() * sizeof(InstanceData);
+        renderStats.Draw(&shader, batch->mesh);
+        renderStats.Uploaded(instances.size() * sizeof(InstanceData));
+    }
+}
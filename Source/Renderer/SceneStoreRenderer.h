@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/Shaders/PhongGL.h>
+
+#include "SceneStore.h"
+
+// What the store looked like through the camera of one frame
+struct SceneSnapshot
+{
+    std::vector<MeshHandle> meshes;
+    std::vector<std::vector<InstanceData>> instances; // one list for each of meshes
+    SceneStore::Stats store;
+};
+
+// Draws the objects of a SceneStore that are inside the camera frustum, one instanced draw call
+// per mesh. Unlike InstanceRenderer the instance buffers are refilled every frame with whatever
+// the store extracted, which suits a store where most objects are culled. Expects the same
+// shader as InstanceRenderer.
+//
+// Updating the store and extracting what's visible is split from drawing, and double buffered:
+// Prepare() fills the back snapshot without touching GL, so it can run on a worker across
+// frames while the GL thread keeps drawing the front one. Present() swaps them once it's done.
+// Objects drawn from an older snapshot were culled with the camera of that snapshot, so what
+// just entered the frustum shows up when the next snapshot is presented.
+class SceneStoreRenderer
+{
+  public:
+    struct Stats
+    {
+        // Last frame only
+        std::size_t drawCalls = 0;
+        std::size_t instances = 0;
+        std::size_t triangles = 0;
+        std::size_t uploadedBytes = 0;
+    };
+
+    SceneStoreRenderer() = default;
+
+    SceneStoreRenderer(const SceneStoreRenderer &) = delete;
+    SceneStoreRenderer &operator=(const SceneStoreRenderer &) = delete;
+
+    // Updates the store and extracts what's visible into the back snapshot. Can run on any
+    // thread, but with nothing else touching the store or calling Present() meanwhile.
+    void Prepare(SceneStore &store, const Magnum::Matrix4 &projectionCamera);
+
+    // Makes the snapshot of the last Prepare() the one drawn, after Prepare() finished
+    void Present();
+
+    // Draws the presented snapshot. GL thread only, can run while Prepare() fills the other one.
+    void Draw(Magnum::Shaders::PhongGL &shader, Magnum::SceneGraph::Camera3D &camera);
+
+    // Changes whenever another snapshot is presented
+    unsigned long long Presented() const
+    {
+        return _presented;
+    }
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    // Store statistics as of the presented snapshot
+    const SceneStore::Stats &StoreStatistics() const
+    {
+        return _snapshots[_front].store;
+    }
+
+  private:
+    struct Batch
+    {
+        explicit Batch(MeshResource &resource);
+
+        Magnum::GL::Mesh mesh;
+        Magnum::GL::Buffer instanceBuffer;
+        std::size_t bufferCapacity = 0;
+        std::size_t triangles = 0;
+    };
+
+    // Indexed like SceneStore::Meshes()
+    std::vector<std::unique_ptr<Batch>> _batches;
+    SceneSnapshot _snapshots[2];
+    std::size_t _front = 0;
+    unsigned long long _presented = 0;
+    Stats _stats;
+};
@@ -0,0 +1,77 @@
+#include "SphereCulling.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CULL_USE_SSE
+#endif
+
+using namespace Magnum;
+
+namespace SphereCulling
+{
+
+void ExtractPlanes(const Matrix4 &matrix, Vector4 (&planes)[6])
+{
+    const Vector4 x = matrix.row(0);
+    const Vector4 y = matrix.row(1);
+    const Vector4 z = matrix.row(2);
+    const Vector4 w = matrix.row(3);
+
+    planes[0] = w + x;
+    planes[1] = w - x;
+    planes[2] = w + y;
+    planes[3] = w - y;
+    planes[4] = w + z;
+    planes[5] = w - z;
+
+    for (Vector4 &plane : planes)
+        plane /= plane.xyz().length();
+}
+
+void TestSpheres(const Vector4 (&planes)[6], const Float *x, const Float *y, const Float *z, const Float *radius,
+                 std::size_t count, UnsignedByte *visible)
+{
+#ifdef CULL_USE_SSE
+    __m128 px[6], py[6], pz[6], pw[6];
+    for (std::size_t p = 0; p != 6; ++p)
+    {
+        px[p] = _mm_set1_ps(planes[p].x());
+        py[p] = _mm_set1_ps(planes[p].y());
+        pz[p] = _mm_set1_ps(planes[p].z());
+        pw[p] = _mm_set1_ps(planes[p].w());
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    for (std::size_t i = 0; i < count; i += BatchSize)
+    {
+        const __m128 cx = _mm_loadu_ps(x + i);
+        const __m128 cy = _mm_loadu_ps(y + i);
+        const __m128 cz = _mm_loadu_ps(z + i);
+        const __m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(radius + i));
+
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (std::size_t p = 0; p != 6; ++p)
+        {
+            const __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(px[p], cx), _mm_mul_ps(py[p], cy)), _mm_add_ps(_mm_mul_ps(pz[p], cz), pw[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        visible[i + 0] = mask & 1;
+        visible[i + 1] = (mask >> 1) & 1;
+        visible[i + 2] = (mask >> 2) & 1;
+        visible[i + 3] = (mask >> 3) & 1;
+    }
+#else
+    for (std::size_t i = 0; i != count; ++i)
+    {
+        bool inside = true;
+        for (const Vector4 &plane : planes)
+            inside &= plane.x() * x[i] + plane.y() * y[i] + plane.z() * z[i] + plane.w() >= -radius[i];
+        visible[i] = inside;
+    }
+#endif
+}
+
+} // namespace SphereCulling
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Vector4.h>
+
+// Building blocks shared by the frustum culler and the scene store
+namespace SphereCulling
+{
+
+// Spheres are tested this many at a time, arrays passed to TestSpheres() are padded to a
+// multiple of it. Padding with a radius of -inf never passes the test.
+constexpr std::size_t BatchSize = 4;
+
+inline std::size_t PaddedSize(std::size_t count)
+{
+    return (count + BatchSize - 1) / BatchSize * BatchSize;
+}
+
+// Frustum planes of a projection * camera matrix, normalized so that the plane equation gives
+// the signed distance. Points inside are on the positive side of all of them.
+void ExtractPlanes(const Magnum::Matrix4 &matrix, Magnum::Vector4 (&planes)[6]);
+
+// Writes 1 for every sphere that is at least partially inside all planes, 0 otherwise
+void TestSpheres(const Magnum::Vector4 (&planes)[6], const Magnum::Float *x, const Magnum::Float *y,
+                 const Magnum::Float *z, const Magnum::Float *radius, std::size_t count, Magnum::UnsignedByte *visible);
+
+} // namespace SphereCulling
@@ -0,0 +1,177 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Matrix3.h>
+
+using namespace Magnum;
+
+namespace Bvh
+{
+
+namespace
+{
+
+constexpr Int BinCount = 16;
+
+Range3D pointBounds(const Vector3 &point)
+{
+    return {point, point};
+}
+
+} // namespace
+
+Ray::Ray(const Vector3 &origin, const Vector3 &direction)
+    : origin{origin}, direction{direction}, invDirection{Vector3{1.0f} / direction}
+{
+}
+
+void Build(const std::vector<Range3D> &bounds, UnsignedInt maxLeafSize, std::vector<Node> &nodes,
+           std::vector<UnsignedInt> &items)
+{
+    nodes.clear();
+    items.resize(bounds.size());
+    std::iota(items.begin(), items.end(), 0u);
+    if (bounds.empty())
+        return;
+
+    std::vector<Vector3> centers(bounds.size());
+    for (std::size_t i = 0; i != bounds.size(); ++i)
+        centers[i] = bounds[i].center();
+
+    nodes.reserve(2 * bounds.size());
+    nodes.push_back({{}, 0, UnsignedInt(bounds.size())});
+
+    std::vector<UnsignedInt> stack{0};
+    while (!stack.empty())
+    {
+        const UnsignedInt index = stack.back();
+        stack.pop_back();
+
+        const UnsignedInt first = nodes[index].first;
+        const UnsignedInt count = nodes[index].count;
+
+        Range3D nodeBounds = bounds[items[first]];
+        Range3D centerBounds = pointBounds(centers[items[first]]);
+        for (UnsignedInt i = first + 1; i != first + count; ++i)
+        {
+            nodeBounds = Join(nodeBounds, bounds[items[i]]);
+            centerBounds = Join(centerBounds, pointBounds(centers[items[i]]));
+        }
+        nodes[index].bounds = nodeBounds;
+
+        if (count <= maxLeafSize)
+            continue;
+
+        // Split along the axis with the largest spread of centers
+        const Vector3 extent = centerBounds.size();
+        const Int axis = extent.x() > extent.y() ? (extent.x() > extent.z() ? 0 : 2) : (extent.y() > extent.z() ? 1 : 2);
+        const Float axisMin = centerBounds.min()[axis];
+        const Float axisExtent = extent[axis];
+
+        UnsignedInt middle = first + count / 2;
+        if (axisExtent > 0.0f)
+        {
+            const auto binOf = [&](UnsignedInt item) {
+                return Math::min(Int((centers[item][axis] - axisMin) * BinCount / axisExtent), BinCount - 1);
+            };
+
+            UnsignedInt binCounts[BinCount]{};
+            Range3D binBounds[BinCount];
+            for (UnsignedInt i = first; i != first + count; ++i)
+            {
+                const Int bin = binOf(items[i]);
+                binBounds[bin] = binCounts[bin] ? Join(binBounds[bin], bounds[items[i]]) : bounds[items[i]];
+                ++binCounts[bin];
+            }
+
+            // Sweep from the right to get the cost of every right side, then from the left
+            Float rightCost[BinCount]{};
+            Range3D accumulated;
+            UnsignedInt accumulatedCount = 0;
+            for (Int bin = BinCount - 1; bin > 0; --bin)
+            {
+                if (binCounts[bin])
+                    accumulated = accumulatedCount ? Join(accumulated, binBounds[bin]) : binBounds[bin];
+                accumulatedCount += binCounts[bin];
+                rightCost[bin] = accumulatedCount * SurfaceArea(accumulated);
+            }
+
+            Int bestBin = -1;
+            Float bestCost = 0.0f;
+            accumulatedCount = 0;
+            for (Int bin = 0; bin < BinCount - 1; ++bin)
+            {
+                if (binCounts[bin])
+                    accumulated = accumulatedCount ? Join(accumulated, binBounds[bin]) : binBounds[bin];
+                accumulatedCount += binCounts[bin];
+                if (!accumulatedCount || accumulatedCount == count)
+                    continue;
+
+                const Float cost = accumulatedCount * SurfaceArea(accumulated) + rightCost[bin + 1];
+                if (bestBin == -1 || cost < bestCost)
+                {
+                    bestBin = bin;
+                    bestCost = cost;
+                }
+            }
+
+            if (bestBin != -1)
+                middle = UnsignedInt(std::partition(items.begin() + first, items.begin() + first + count,
+                                                    [&](UnsignedInt item) { return binOf(item) <= bestBin; }) -
+                                     items.begin());
+        }
+
+        // All centers in one spot, split in half to keep the tree from degenerating
+        if (middle == first || middle == first + count)
+            middle = first + count / 2;
+
+        const UnsignedInt left = UnsignedInt(nodes.size());
+        nodes.push_back({{}, first, middle - first});
+        nodes.push_back({{}, middle, first + count - middle});
+        nodes[index].first = left;
+        nodes[index].count = 0;
+
+        stack.push_back(left);
+        stack.push_back(left + 1);
+    }
+}
+
+bool IntersectBounds(const Ray &ray, const Range3D &bounds, Float tMax, Float &tNear)
+{
+    const Vector3 t0 = (bounds.min() - ray.origin) * ray.invDirection;
+    const Vector3 t1 = (bounds.max() - ray.origin) * ray.invDirection;
+
+    tNear = Math::max(Math::min(t0, t1).max(), 0.0f);
+    const Float tFar = Math::min(Math::max(t0, t1).min(), tMax);
+    return tNear <= tFar;
+}
+
+Range3D TransformBounds(const Matrix4 &transformation, const Range3D &bounds)
+{
+    // Transform the center, the extent grows by the absolute value of the rotation/scale part
+    const Vector3 center = transformation.transformPoint(bounds.center());
+    const Vector3 halfSize = bounds.size() * 0.5f;
+    const Matrix3 linear = transformation.rotationScaling();
+
+    Vector3 extent;
+    for (Int column = 0; column != 3; ++column)
+        extent += Math::abs(linear[column]) * halfSize[column];
+
+    return {center - extent, center + extent};
+}
+
+Range3D Join(const Range3D &a, const Range3D &b)
+{
+    return {Math::min(a.min(), b.min()), Math::max(a.max(), b.max())};
+}
+
+Float SurfaceArea(const Range3D &bounds)
+{
+    const Vector3 size = bounds.size();
+    return 2.0f * (size.x() * size.y() + size.y() * size.z() + size.z() * size.x());
+}
+
+} // namespace Bvh
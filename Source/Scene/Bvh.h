@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Math/Vector3.h>
+
+// Building blocks shared by the mesh (bottom-level) and scene (top-level) BVHs
+namespace Bvh
+{
+
+struct Ray
+{
+    Ray(const Magnum::Vector3 &origin, const Magnum::Vector3 &direction);
+
+    Magnum::Vector3 origin;
+    Magnum::Vector3 direction;
+    Magnum::Vector3 invDirection;
+};
+
+// Children of an inner node are stored next to each other at `first` and `first + 1`, always
+// after their parent. Leaves reference `count` consecutive entries of the item array.
+struct Node
+{
+    Magnum::Range3D bounds;
+    Magnum::UnsignedInt first;
+    Magnum::UnsignedInt count; // zero for inner nodes
+};
+
+// Builds a tree over the item bounds with a binned SAH split. The item order the leaves refer
+// to is written to `items`.
+void Build(const std::vector<Magnum::Range3D> &bounds, Magnum::UnsignedInt maxLeafSize, std::vector<Node> &nodes,
+           std::vector<Magnum::UnsignedInt> &items);
+
+// Slab test, `tNear` receives the entry distance clamped to zero
+bool IntersectBounds(const Ray &ray, const Magnum::Range3D &bounds, Magnum::Float tMax, Magnum::Float &tNear);
+
+// Axis-aligned bounds of transformed bounds
+Magnum::Range3D TransformBounds(const Magnum::Matrix4 &transformation, const Magnum::Range3D &bounds);
+
+// Unlike Math::join() this doesn't treat zero-sized bounds as empty
+Magnum::Range3D Join(const Magnum::Range3D &a, const Magnum::Range3D &b);
+
+Magnum::Float SurfaceArea(const Magnum::Range3D &bounds);
+
+} // namespace Bvh
@@ -0,0 +1,148 @@
+#include "MeshBvh.h"
+
+#include <algorithm>
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Mesh.h>
+#include <Magnum/Trade/MeshData.h>
+
+using namespace Magnum;
+
+namespace
+{
+
+constexpr UnsignedInt MaxTrianglesPerLeaf = 4;
+
+// SAH trees over mesh triangles stay far shallower than this, deeper ones traverse with a
+// stack on the heap
+constexpr std::size_t MaxStackSize = 64;
+
+// Möller-Trumbore, the direction doesn't need to be normalized
+bool intersectTriangle(const Bvh::Ray &ray, const Vector3 &a, const Vector3 &b, const Vector3 &c, Float &t)
+{
+    const Vector3 ab = b - a;
+    const Vector3 ac = c - a;
+    const Vector3 p = Math::cross(ray.direction, ac);
+    const Float determinant = Math::dot(ab, p);
+    if (Math::abs(determinant) < 1.0e-12f)
+        return false;
+
+    const Float invDeterminant = 1.0f / determinant;
+    const Vector3 s = ray.origin - a;
+    const Float u = Math::dot(s, p) * invDeterminant;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+
+    const Vector3 q = Math::cross(s, ab);
+    const Float v = Math::dot(ray.direction, q) * invDeterminant;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+
+    const Float hit = Math::dot(ac, q) * invDeterminant;
+    if (hit < 0.0f || hit >= t)
+        return false;
+
+    t = hit;
+    return true;
+}
+
+} // namespace
+
+MeshBvh::MeshBvh(const Trade::MeshData &mesh)
+{
+    if (mesh.primitive() != MeshPrimitive::Triangles || !mesh.hasAttribute(Trade::MeshAttribute::Position))
+        return;
+
+    const Containers::Array<Vector3> positions = mesh.positions3DAsArray();
+    Containers::Array<UnsignedInt> indices;
+    if (mesh.isIndexed())
+        indices = mesh.indicesAsArray();
+    else
+    {
+        indices = Containers::Array<UnsignedInt>{positions.size()};
+        for (UnsignedInt i = 0; i != indices.size(); ++i)
+            indices[i] = i;
+    }
+
+    const std::size_t triangleCount = indices.size() / 3;
+    std::vector<Range3D> bounds(triangleCount);
+    for (std::size_t i = 0; i != triangleCount; ++i)
+    {
+        const Vector3 &a = positions[indices[3 * i + 0]];
+        const Vector3 &b = positions[indices[3 * i + 1]];
+        const Vector3 &c = positions[indices[3 * i + 2]];
+        bounds[i] = {Math::min(Math::min(a, b), c), Math::max(Math::max(a, b), c)};
+    }
+
+    std::vector<UnsignedInt> order;
+    Bvh::Build(bounds, MaxTrianglesPerLeaf, _nodes, order);
+
+    _triangles.reserve(3 * triangleCount);
+    for (UnsignedInt triangle : order)
+        for (UnsignedInt corner = 0; corner != 3; ++corner)
+            _triangles.push_back(positions[indices[3 * triangle + corner]]);
+
+    if (!_nodes.empty())
+        _bounds = _nodes[0].bounds;
+
+    // Children come after their parent, so one pass gets every depth. Traversal keeps at most
+    // one sibling per level on the stack plus the two children it's about to push.
+    std::vector<UnsignedInt> depths(_nodes.size(), 0);
+    for (std::size_t i = 0; i != _nodes.size(); ++i)
+    {
+        _stackSize = std::max(_stackSize, std::size_t(depths[i]) + 1);
+        if (!_nodes[i].count)
+            depths[_nodes[i].first] = depths[_nodes[i].first + 1] = depths[i] + 1;
+    }
+}
+
+bool MeshBvh::Intersect(const Bvh::Ray &ray, Float &t) const
+{
+    if (_nodes.empty())
+        return false;
+
+    bool found = false;
+    Float tNear;
+    UnsignedInt fixedStack[MaxStackSize];
+    std::vector<UnsignedInt> heapStack;
+    UnsignedInt *stack = fixedStack;
+    if (_stackSize > MaxStackSize)
+    {
+        heapStack.resize(_stackSize);
+        stack = heapStack.data();
+    }
+    std::size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize)
+    {
+        const Bvh::Node &node = _nodes[stack[--stackSize]];
+        if (!Bvh::IntersectBounds(ray, node.bounds, t, tNear))
+            continue;
+
+        if (node.count)
+        {
+            for (UnsignedInt i = node.first; i != node.first + node.count; ++i)
+                found |= intersectTriangle(ray, _triangles[3 * i + 0], _triangles[3 * i + 1], _triangles[3 * i + 2], t);
+            continue;
+        }
+
+        // Visit the nearer child first so the far one is more likely to be culled
+        Float tLeft, tRight;
+        const bool left = Bvh::IntersectBounds(ray, _nodes[node.first].bounds, t, tLeft);
+        const bool right = Bvh::IntersectBounds(ray, _nodes[node.first + 1].bounds, t, tRight);
+        if (left && right)
+        {
+            const bool leftFirst = tLeft <= tRight;
+            stack[stackSize++] = leftFirst ? node.first + 1 : node.first;
+            stack[stackSize++] = leftFirst ? node.first : node.first + 1;
+        }
+        else if (left)
+            stack[stackSize++] = node.first;
+        else if (right)
+            stack[stackSize++] = node.first + 1;
+    }
+
+    return found;
+}
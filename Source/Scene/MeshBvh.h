@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include <Magnum/Trade/Trade.h>
+
+#include "Bvh.h"
+
+// Bottom-level BVH over the triangles of a mesh, in mesh space. Built once from the
+// Trade::MeshData a GL::Mesh is compiled from and shared by all objects using that mesh.
+class MeshBvh
+{
+  public:
+    explicit MeshBvh(const Magnum::Trade::MeshData &mesh);
+
+    // Finds the nearest triangle hit closer than `t`, which then receives the hit distance
+    bool Intersect(const Bvh::Ray &ray, Magnum::Float &t) const;
+
+    const Magnum::Range3D &Bounds() const
+    {
+        return _bounds;
+    }
+
+    std::size_t TriangleCount() const
+    {
+        return _triangles.size() / 3;
+    }
+
+  private:
+    // Triangle corners in leaf order, three per triangle
+    std::vector<Magnum::Vector3> _triangles;
+    std::vector<Bvh::Node> _nodes;
+    Magnum::Range3D _bounds;
+    std::size_t _stackSize = 0; // deepest leaf plus one, what traversal needs at most
+};
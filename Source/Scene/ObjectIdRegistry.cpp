@@ -0,0 +1,86 @@
+#include "ObjectIdRegistry.h"
+
+using namespace Magnum;
+
+UnsignedInt ObjectIdRegistry::Register(Object3D *object)
+{
+    ++_count;
+
+    UnsignedInt id;
+    if (!_free.empty())
+    {
+        id = _free.back();
+        _free.pop_back();
+        _objects[id] = object;
+    }
+    else
+    {
+        id = UnsignedInt(_objects.size());
+        _objects.push_back(object);
+        _generations.push_back(0);
+    }
+
+    _ids[object] = id;
+    return id;
+}
+
+UnsignedInt ObjectIdRegistry::ReserveRange(std::size_t count)
+{
+    const UnsignedInt first = UnsignedInt(_objects.size());
+    _objects.resize(_objects.size() + count, nullptr);
+    _generations.resize(_objects.size(), 0);
+    _ids.reserve(_ids.size() + count);
+    return first;
+}
+
+void ObjectIdRegistry::Assign(UnsignedInt id, Object3D *object)
+{
+    ++_count;
+    _objects[id] = object;
+    _ids[object] = id;
+}
+
+void ObjectIdRegistry::Unregister(UnsignedInt id)
+{
+    if (id == InvalidId || id >= _objects.size() || _objects[id] == nullptr)
+        return;
+
+    --_count;
+    _ids.erase(_objects[id]);
+    _objects[id] = nullptr;
+    ++_generations[id];
+    _quarantine.push_back({id, _frame});
+}
+
+Object3D *ObjectIdRegistry::Find(UnsignedInt id) const
+{
+    return id < _objects.size() ? _objects[id] : nullptr;
+}
+
+ObjectHandle ObjectIdRegistry::HandleOf(Object3D *object) const
+{
+    auto found = _ids.find(object);
+    if (found == _ids.end())
+        return {};
+
+    return {found->second, _generations[found->second]};
+}
+
+Object3D *ObjectIdRegistry::Resolve(ObjectHandle handle) const
+{
+    if (handle.id >= _objects.size() || _generations[handle.id] != handle.generation)
+        return nullptr;
+
+    return _objects[handle.id];
+}
+
+void ObjectIdRegistry::BeginFrame()
+{
+    ++_frame;
+
+    while (!_quarantine.empty() && _frame - _quarantine.front().frame > recycleDelayFrames)
+    {
+        _free.push_back(_quarantine.front().id);
+        _quarantine.pop_front();
+    }
+}
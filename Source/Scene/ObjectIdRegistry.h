@@ -0,0 +1,71 @@
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include <Magnum/Magnum.h>
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+#include <Magnum/SceneGraph/Object.h>
+
+using Object3D = Magnum::SceneGraph::Object<Magnum::SceneGraph::MatrixTransformation3D>;
+
+// Long-lived reference to a registered object. The generation changes when the ID is released,
+// so a handle kept past the object's lifetime resolves to null instead of dangling.
+struct ObjectHandle
+{
+    Magnum::UnsignedInt id = 0;
+    Magnum::UnsignedInt generation = 0;
+};
+
+// Hands out 32-bit object IDs written into the object ID attachment and maps them back to
+// objects. ID 0 is reserved for "nothing". Released IDs are recycled, but only after a few
+// frames so that picks still in flight cannot resolve to an object that reused the ID.
+class ObjectIdRegistry
+{
+  public:
+    static constexpr Magnum::UnsignedInt InvalidId = 0;
+
+    Magnum::UnsignedInt Register(Object3D *object);
+    void Unregister(Magnum::UnsignedInt id);
+
+    // Reserves a range of consecutive new IDs and returns the first. Every ID of the range has
+    // to be assigned an object before it can be unregistered.
+    Magnum::UnsignedInt ReserveRange(std::size_t count);
+    void Assign(Magnum::UnsignedInt id, Object3D *object);
+
+    // Returns nullptr for unknown or released IDs
+    Object3D *Find(Magnum::UnsignedInt id) const;
+
+    // Handle of a registered object, or a null one
+    ObjectHandle HandleOf(Object3D *object) const;
+
+    // Returns nullptr for handles of released objects
+    Object3D *Resolve(ObjectHandle handle) const;
+
+    // Call once per frame, releases quarantined IDs for reuse
+    void BeginFrame();
+
+    std::size_t Count() const
+    {
+        return _count;
+    }
+
+    // Should be at least the latency of the picking readback
+    unsigned int recycleDelayFrames = 4;
+
+  private:
+    struct Released
+    {
+        Magnum::UnsignedInt id;
+        unsigned long long frame;
+    };
+
+    std::vector<Object3D *> _objects{nullptr};
+    std::vector<Magnum::UnsignedInt> _generations{0};
+    std::unordered_map<Object3D *, Magnum::UnsignedInt> _ids;
+    std::vector<Magnum::UnsignedInt> _free;
+    std::deque<Released> _quarantine;
+    unsigned long long _frame = 0;
+    std::size_t _count = 0;
+};
@@ -0,0 +1,113 @@
+#include "ObjectPool.h"
+
+#include <algorithm>
+#include <new>
+
+namespace
+{
+
+// Size classes are multiples of the alignment, up to the largest one
+constexpr std::size_t Alignment = alignof(std::max_align_t);
+constexpr std::size_t MaxBlockSize = 1024;
+constexpr std::size_t ChunkSize = 64 * 1024;
+
+std::size_t sizeClass(std::size_t size)
+{
+    return (size + Alignment - 1) / Alignment;
+}
+
+} // namespace
+
+ObjectPool &ObjectPool::Shared()
+{
+    static ObjectPool pool;
+    return pool;
+}
+
+ObjectPool::~ObjectPool()
+{
+    for (char *chunk : _chunks)
+        ::operator delete(chunk);
+}
+
+void *ObjectPool::Allocate(std::size_t size)
+{
+    ++_allocations;
+    if (size > MaxBlockSize)
+    {
+        ++_heapFallbacks;
+        return ::operator new(size);
+    }
+
+    const std::size_t index = sizeClass(size);
+    if (index >= _freeLists.size() || !_freeLists[index])
+        _carve(index, ChunkSize);
+
+    FreeBlock *block = _freeLists[index];
+    _freeLists[index] = block->next;
+    --_freeCounts[index];
+    ++_stats.liveBlocks;
+    return block;
+}
+
+void ObjectPool::Deallocate(void *pointer, std::size_t size)
+{
+    if (!pointer)
+        return;
+
+    ++_deallocations;
+    if (size > MaxBlockSize)
+    {
+        ::operator delete(pointer);
+        return;
+    }
+
+    FreeBlock *block = static_cast<FreeBlock *>(pointer);
+    const std::size_t index = sizeClass(size);
+    block->next = _freeLists[index];
+    _freeLists[index] = block;
+    ++_freeCounts[index];
+    --_stats.liveBlocks;
+}
+
+void ObjectPool::Reserve(std::size_t size, std::size_t count)
+{
+    if (size > MaxBlockSize)
+        return;
+
+    const std::size_t index = sizeClass(size);
+    const std::size_t available = index < _freeCounts.size() ? _freeCounts[index] : 0;
+    if (count > available)
+        _carve(index, std::max(ChunkSize, (count - available) * index * Alignment));
+}
+
+void ObjectPool::_carve(std::size_t index, std::size_t bytes)
+{
+    if (index >= _freeLists.size())
+    {
+        _freeLists.resize(index + 1, nullptr);
+        _freeCounts.resize(index + 1, 0);
+    }
+
+    const std::size_t blockSize = index * Alignment;
+    char *chunk = static_cast<char *>(::operator new(bytes));
+    _chunks.push_back(chunk);
+    _stats.reservedBytes += bytes;
+
+    // In reverse so that blocks are handed out in address order
+    for (std::size_t offset = bytes / blockSize * blockSize; offset != 0; offset -= blockSize)
+    {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(chunk + offset - blockSize);
+        block->next = _freeLists[index];
+        _freeLists[index] = block;
+        ++_freeCounts[index];
+    }
+}
+
+void ObjectPool::BeginFrame()
+{
+    _stats.allocations = _allocations;
+    _stats.deallocations = _deallocations;
+    _stats.heapFallbacks = _heapFallbacks;
+    _allocations = _deallocations = _heapFallbacks = 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Free-list allocator for scene objects and their features. Allocations are rounded up to a
+// size class, carved out of large chunks and put on the free list of their class when deleted,
+// so spawning and removing objects reuses memory instead of going through the general heap.
+// Chunks are only released with the pool. Not thread-safe.
+class ObjectPool
+{
+  public:
+    struct Stats
+    {
+        std::size_t liveBlocks = 0;
+        std::size_t reservedBytes = 0;
+
+        // During the last full frame
+        std::size_t allocations = 0;
+        std::size_t deallocations = 0;
+        std::size_t heapFallbacks = 0; // too large for any size class
+    };
+
+    // The pool every Pooled class allocates from
+    static ObjectPool &Shared();
+
+    ObjectPool() = default;
+    ~ObjectPool();
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    void *Allocate(std::size_t size);
+    void Deallocate(void *pointer, std::size_t size);
+
+    // Makes sure the next count allocations of this size don't need more than one new chunk
+    void Reserve(std::size_t size, std::size_t count);
+
+    // Publishes the counters of the frame that just ended
+    void BeginFrame();
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+  private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    void _carve(std::size_t index, std::size_t bytes);
+
+    std::vector<FreeBlock *> _freeLists;
+    std::vector<std::size_t> _freeCounts;
+    std::vector<char *> _chunks;
+
+    // Counted since the last BeginFrame()
+    std::size_t _allocations = 0;
+    std::size_t _deallocations = 0;
+    std::size_t _heapFallbacks = 0;
+    Stats _stats;
+};
+
+// Makes instances of the deriving class allocate from the shared ObjectPool. Deleting through a
+// base pointer works as long as the base has a virtual destructor, as scene graph objects and
+// features do.
+class Pooled
+{
+  public:
+    static void *operator new(std::size_t size)
+    {
+        return ObjectPool::Shared().Allocate(size);
+    }
+
+    static void operator delete(void *pointer, std::size_t size)
+    {
+        ObjectPool::Shared().Deallocate(pointer, size);
+    }
+};
@@ -0,0 +1,97 @@
+#include "PropagationBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <Magnum/Math/Angle.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include "JobSystem.h"
+#include "SceneStore.h"
+
+using namespace Magnum;
+using namespace Math::Literals;
+
+namespace
+{
+
+constexpr std::size_t Branching = 8;
+
+double timeUpdates(SceneStore &store, const std::vector<SceneHandle> &handles, unsigned int repeats)
+{
+    // Every run starts from the same state and applies the same rotations
+    store.SetTransformation(handles.front(), Matrix4{});
+    store.Update();
+
+    double total = 0.0;
+    for (unsigned int i = 0; i != repeats; ++i)
+    {
+        // Moving the root moves everything
+        const Matrix4 rootTransformation = Matrix4::rotationY(Deg(Float(i + 1)));
+        store.SetTransformation(handles.front(), rootTransformation);
+
+        const auto start = std::chrono::steady_clock::now();
+        store.Update();
+        total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return total / repeats;
+}
+
+std::vector<Matrix4> worldTransformations(const SceneStore &store, const std::vector<SceneHandle> &handles)
+{
+    std::vector<Matrix4> world;
+    world.reserve(handles.size());
+    for (SceneHandle handle : handles)
+        world.push_back(store.World(handle));
+    return world;
+}
+
+} // namespace
+
+std::vector<PropagationTiming> BenchmarkPropagation(const MeshHandle &mesh, std::size_t objectCount,
+                                                    unsigned int repeats)
+{
+    SceneStore store;
+    const UnsignedInt material = store.AddMaterial({});
+
+    // Children are offset and turned a little, so that rounding differences would show
+    std::vector<SceneHandle> handles;
+    handles.reserve(objectCount);
+    for (std::size_t i = 0; i != objectCount; ++i)
+    {
+        const Matrix4 transformation = Matrix4::translation({1.0f + (i % 7) * 0.1f, 0.5f, -0.25f}) *
+                                       Matrix4::rotationZ(Deg(Float(i % 13))) * Matrix4::scaling(Vector3{0.99f});
+        handles.push_back(
+            store.Create(mesh, material, transformation, i ? handles[(i - 1) / Branching] : SceneHandle{}));
+    }
+
+    std::vector<PropagationTiming> timings;
+    store.Update();
+    timings.push_back({1, timeUpdates(store, handles, repeats), 1.0, true});
+    const std::vector<Matrix4> serial = worldTransformations(store, handles);
+
+    const unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 2u);
+    for (unsigned int threads = 2;; threads = std::min(threads * 2, hardwareThreads))
+    {
+        JobSystem jobs{threads - 1};
+        store.jobs = &jobs;
+
+        PropagationTiming timing;
+        timing.threads = threads;
+        timing.milliseconds = timeUpdates(store, handles, repeats);
+        timing.speedup = timings.front().milliseconds / timing.milliseconds;
+
+        // Both ran the same root rotations, so the last one left the same results
+        const std::vector<Matrix4> parallel = worldTransformations(store, handles);
+        timing.identical = std::memcmp(parallel.data(), serial.data(), serial.size() * sizeof(Matrix4)) == 0;
+        timings.push_back(timing);
+
+        store.jobs = nullptr;
+        if (threads == hardwareThreads)
+            break;
+    }
+
+    return timings;
+}
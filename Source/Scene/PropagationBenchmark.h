@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+#include "MeshLibrary.h"
+
+struct PropagationTiming
+{
+    unsigned int threads = 0;
+    double milliseconds = 0.0; // average of one full update
+    double speedup = 1.0;      // over the serial update
+    bool identical = true;     // world transformations match the serial ones bit for bit
+};
+
+// Times SceneStore::Update() on a synthetic hierarchy with every object moving, first serially
+// and then in parallel on 2, 4, ... threads up to the hardware concurrency. The hierarchy is a
+// complete 8-ary tree, which gives a few very wide levels.
+std::vector<PropagationTiming> BenchmarkPropagation(const MeshHandle &mesh, std::size_t objectCount = 1000000,
+                                                    unsigned int repeats = 5);
@@ -0,0 +1,371 @@
+#include "SceneBvh.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Intersection.h>
+
+using namespace Magnum;
+
+namespace
+{
+
+constexpr UnsignedInt MaxObjectsPerLeaf = 2;
+constexpr UnsignedInt NoParent = ~0u;
+
+// Scanning a handful of unindexed objects is cheaper than rebuilding for them
+constexpr std::size_t MinUnindexedBeforeRebuild = 16;
+
+const Range3D EmptyBounds{Vector3{Constants::inf()}, Vector3{-Constants::inf()}};
+
+// Leaves whose objects were all removed. Bvh::IntersectBounds() would accept these.
+bool isEmpty(const Range3D &bounds)
+{
+    return bounds.min().x() > bounds.max().x();
+}
+
+Float area(const Range3D &bounds)
+{
+    return isEmpty(bounds) ? 0.0f : Bvh::SurfaceArea(bounds);
+}
+
+bool intersect(const Bvh::Ray &ray, const Range3D &bounds, Float tMax, Float &tNear)
+{
+    return !isEmpty(bounds) && Bvh::IntersectBounds(ray, bounds, tMax, tNear);
+}
+
+bool overlaps(const Range3D &a, const Range3D &b)
+{
+    return (a.min() <= b.max()).all() && (b.min() <= a.max()).all();
+}
+
+bool overlaps(const Range3D &bounds, const Vector3 &center, Float radiusSquared)
+{
+    return !isEmpty(bounds) && (Math::clamp(center, bounds.min(), bounds.max()) - center).dot() <= radiusSquared;
+}
+
+} // namespace
+
+void SceneBvh::Refit()
+{
+    _refitLeaves();
+
+    const std::size_t unindexed = _entries.size() - _indexedCount + _freeSlots.size();
+    _stats.costGrowth = _buildCost > 0.0f ? _cost() / _buildCost : 1.0f;
+
+    // Refitting keeps the topology, which gets worse the more objects have moved. Objects added
+    // since the last build are only scanned linearly.
+    if ((unindexed > MinUnindexedBeforeRebuild && unindexed > maxUnindexedFraction * _objectCount) ||
+        _stats.costGrowth > maxCostGrowth)
+        _rebuild();
+
+    _stats.objects = _objectCount;
+    _stats.nodes = _nodes.size();
+    _stats.unindexed = _entries.size() - _indexedCount;
+}
+
+bool SceneBvh::Raycast(const Vector3 &origin, const Vector3 &direction, Hit &hit)
+{
+    return _raycast(Bvh::Ray{origin, direction}, hit);
+}
+
+void SceneBvh::Raycast(const std::vector<Bvh::Ray> &rays, std::vector<Hit> &hits)
+{
+    hits.resize(rays.size());
+    for (std::size_t i = 0; i != rays.size(); ++i)
+    {
+        if (!_raycast(rays[i], hits[i]))
+            hits[i] = {nullptr, Constants::inf()};
+    }
+}
+
+void SceneBvh::QueryBox(const Range3D &box, std::vector<Object3D *> &objects)
+{
+    _forEachOverlapping([&box](const Range3D &bounds) { return overlaps(bounds, box); },
+                        [&objects](BvhPickable &entry) { objects.push_back(&entry._owner); });
+}
+
+void SceneBvh::QuerySphere(const Vector3 &center, Float radius, std::vector<Object3D *> &objects)
+{
+    const Float radiusSquared = radius * radius;
+    _forEachOverlapping([&](const Range3D &bounds) { return overlaps(bounds, center, radiusSquared); },
+                        [&objects](BvhPickable &entry) { objects.push_back(&entry._owner); });
+}
+
+void SceneBvh::QueryFrustum(const Frustum &frustum, std::vector<Object3D *> &objects)
+{
+    _forEachOverlapping(
+        [&frustum](const Range3D &bounds) {
+            return !isEmpty(bounds) && Math::Intersection::rangeFrustum(bounds, frustum);
+        },
+        [&objects](BvhPickable &entry) { objects.push_back(&entry._owner); });
+}
+
+bool SceneBvh::_raycast(const Bvh::Ray &ray, Hit &hit)
+{
+    Float t = Constants::inf();
+    BvhPickable *nearest = nullptr;
+    Float tNear;
+
+    const auto test = [&](BvhPickable &entry) {
+        if (!Bvh::IntersectBounds(ray, entry._worldBounds, t, tNear))
+            return;
+
+        // The direction is not renormalized, so distances stay comparable across objects
+        const Bvh::Ray local{entry._worldInverted.transformPoint(ray.origin),
+                             entry._worldInverted.transformVector(ray.direction)};
+        if (entry._mesh->Intersect(local, t))
+            nearest = &entry;
+    };
+
+    _stack.clear();
+    if (!_nodes.empty())
+        _stack.push_back(0);
+    while (!_stack.empty())
+    {
+        const Bvh::Node &node = _nodes[_stack.back()];
+        _stack.pop_back();
+        if (!intersect(ray, node.bounds, t, tNear))
+            continue;
+
+        if (node.count)
+        {
+            for (UnsignedInt i = node.first; i != node.first + node.count; ++i)
+            {
+                if (BvhPickable *entry = _entries[_items[i]])
+                    test(*entry);
+            }
+            continue;
+        }
+
+        Float tLeft, tRight;
+        const bool left = intersect(ray, _nodes[node.first].bounds, t, tLeft);
+        const bool right = intersect(ray, _nodes[node.first + 1].bounds, t, tRight);
+        if (left && right)
+        {
+            // Nearer child on top of the stack
+            const bool leftFirst = tLeft <= tRight;
+            _stack.push_back(leftFirst ? node.first + 1 : node.first);
+            _stack.push_back(leftFirst ? node.first : node.first + 1);
+        }
+        else if (left)
+            _stack.push_back(node.first);
+        else if (right)
+            _stack.push_back(node.first + 1);
+    }
+
+    for (std::size_t i = _indexedCount; i != _entries.size(); ++i)
+    {
+        if (BvhPickable *entry = _entries[i])
+            test(*entry);
+    }
+
+    if (!nearest)
+        return false;
+
+    hit = {&nearest->_owner, t};
+    return true;
+}
+
+template <class NodeTest, class Function> void SceneBvh::_forEachOverlapping(NodeTest test, Function function)
+{
+    _stack.clear();
+    if (!_nodes.empty())
+        _stack.push_back(0);
+    while (!_stack.empty())
+    {
+        const Bvh::Node &node = _nodes[_stack.back()];
+        _stack.pop_back();
+        if (!test(node.bounds))
+            continue;
+
+        if (node.count)
+        {
+            for (UnsignedInt i = node.first; i != node.first + node.count; ++i)
+            {
+                BvhPickable *entry = _entries[_items[i]];
+                if (entry && test(entry->_worldBounds))
+                    function(*entry);
+            }
+        }
+        else
+        {
+            _stack.push_back(node.first + 1);
+            _stack.push_back(node.first);
+        }
+    }
+
+    for (std::size_t i = _indexedCount; i != _entries.size(); ++i)
+    {
+        BvhPickable *entry = _entries[i];
+        if (entry && test(entry->_worldBounds))
+            function(*entry);
+    }
+}
+
+void SceneBvh::_add(BvhPickable &entry)
+{
+    ++_objectCount;
+
+    // Take over an empty slot in the tree, its leaf gets refit once the entry is cleaned
+    if (!_freeSlots.empty())
+    {
+        entry._index = _freeSlots.back();
+        _freeSlots.pop_back();
+        _entries[entry._index] = &entry;
+        return;
+    }
+
+    entry._index = UnsignedInt(_entries.size());
+    _entries.push_back(&entry);
+}
+
+void SceneBvh::_remove(BvhPickable &entry)
+{
+    --_objectCount;
+    _entries[entry._index] = nullptr;
+
+    if (entry._index < _indexedCount)
+    {
+        _freeSlots.push_back(entry._index);
+        _dirtyLeaves.push_back(_leafOf[entry._index]);
+    }
+    else
+    {
+        while (_entries.size() > _indexedCount && !_entries.back())
+            _entries.pop_back();
+    }
+}
+
+void SceneBvh::_updateBounds(BvhPickable &entry)
+{
+    if (entry._index < _indexedCount)
+        _dirtyLeaves.push_back(_leafOf[entry._index]);
+}
+
+void SceneBvh::_refitLeaves()
+{
+    if (_dirtyLeaves.empty())
+        return;
+
+    const auto refitNode = [this](UnsignedInt index) {
+        Bvh::Node &node = _nodes[index];
+        _addArea(-double(area(node.bounds)));
+        if (node.count)
+        {
+            node.bounds = EmptyBounds;
+            for (UnsignedInt i = node.first; i != node.first + node.count; ++i)
+            {
+                if (const BvhPickable *entry = _entries[_items[i]])
+                    node.bounds = isEmpty(node.bounds) ? entry->_worldBounds
+                                                       : Bvh::Join(node.bounds, entry->_worldBounds);
+            }
+        }
+        else
+        {
+            const Range3D &left = _nodes[node.first].bounds;
+            const Range3D &right = _nodes[node.first + 1].bounds;
+            node.bounds = isEmpty(left) ? right : isEmpty(right) ? left : Bvh::Join(left, right);
+        }
+        _addArea(double(area(node.bounds)));
+    };
+
+    // Walk up from every touched leaf. When a large part of the tree changed, one bottom-up
+    // pass over all nodes is cheaper; children are always stored after their parent.
+    if (_dirtyLeaves.size() * 8 > _nodes.size())
+    {
+        for (std::size_t i = _nodes.size(); i != 0; --i)
+            refitNode(UnsignedInt(i - 1));
+    }
+    else
+    {
+        for (UnsignedInt leaf : _dirtyLeaves)
+            for (UnsignedInt index = leaf; index != NoParent; index = _parents[index])
+                refitNode(index);
+    }
+    _dirtyLeaves.clear();
+}
+
+void SceneBvh::_rebuild()
+{
+    // Compact the slots, dropping the removed objects
+    std::size_t count = 0;
+    for (BvhPickable *entry : _entries)
+    {
+        if (!entry)
+            continue;
+        entry->_index = UnsignedInt(count);
+        _entries[count++] = entry;
+    }
+    _entries.resize(count);
+    _freeSlots.clear();
+    _dirtyLeaves.clear();
+
+    std::vector<Range3D> bounds(count);
+    for (std::size_t i = 0; i != count; ++i)
+        bounds[i] = _entries[i]->_worldBounds;
+
+    Bvh::Build(bounds, MaxObjectsPerLeaf, _nodes, _items);
+    _indexedCount = count;
+
+    _parents.assign(_nodes.size(), NoParent);
+    _leafOf.assign(count, 0);
+    _areaSum = _areaError = 0.0;
+    for (UnsignedInt index = 0; index != _nodes.size(); ++index)
+    {
+        const Bvh::Node &node = _nodes[index];
+        _addArea(double(area(node.bounds)));
+        if (node.count)
+        {
+            for (UnsignedInt i = node.first; i != node.first + node.count; ++i)
+                _leafOf[_items[i]] = index;
+        }
+        else
+        {
+            _parents[node.first] = index;
+            _parents[node.first + 1] = index;
+        }
+    }
+
+    _buildCost = _cost();
+    _stats.costGrowth = 1.0f;
+    ++_stats.rebuilds;
+}
+
+Float SceneBvh::_cost() const
+{
+    // Surface area heuristic with equal traversal and intersection costs: the expected number
+    // of nodes a random ray visits, relative to hitting the root
+    const Float rootArea = _nodes.empty() ? 0.0f : area(_nodes[0].bounds);
+    return rootArea > 0.0f ? Float(_areaSum / double(rootArea)) : 0.0f;
+}
+
+void SceneBvh::_addArea(double value)
+{
+    // Kahan summation, the error of each addition is carried into the next one
+    const double corrected = value - _areaError;
+    const double sum = _areaSum + corrected;
+    _areaError = (sum - _areaSum) - corrected;
+    _areaSum = sum;
+}
+
+BvhPickable::BvhPickable(Object3D &object, SceneBvh &bvh, std::shared_ptr<const MeshBvh> mesh)
+    : SceneGraph::AbstractFeature3D{object}, _owner(object), _bvh(bvh), _mesh(std::move(mesh))
+{
+    setCachedTransformations(SceneGraph::CachedTransformation::Absolute);
+
+    _bvh._add(*this);
+}
+
+BvhPickable::~BvhPickable()
+{
+    _bvh._remove(*this);
+}
+
+void BvhPickable::clean(const Matrix4 &absoluteTransformationMatrix)
+{
+    _worldInverted = absoluteTransformationMatrix.inverted();
+    _worldBounds = Bvh::TransformBounds(absoluteTransformationMatrix, _mesh->Bounds());
+    _bvh._updateBounds(*this);
+}
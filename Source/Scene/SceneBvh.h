@@ -0,0 +1,152 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/SceneGraph/AbstractFeature.h>
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+#include <Magnum/SceneGraph/Object.h>
+
+#include "MeshBvh.h"
+#include "ObjectPool.h"
+
+using Object3D = Magnum::SceneGraph::Object<Magnum::SceneGraph::MatrixTransformation3D>;
+
+class BvhPickable;
+
+// Two-level BVH over the scene, used for picking and spatial queries. The top level is built
+// over the world bounds of every object with a BvhPickable feature, the bottom level is the
+// MeshBvh shared by every object using the same mesh.
+//
+// The top level is maintained incrementally. Moving an object only refits the path from its
+// leaf to the root. Removed objects leave an empty slot in their leaf that the next added
+// object takes over; objects added beyond that are kept in an unindexed tail that queries scan
+// linearly. The tree is rebuilt once the tail grows too long or refits made it noticeably
+// worse than a fresh build, measured by the surface area heuristic.
+class SceneBvh
+{
+  public:
+    struct Hit
+    {
+        Object3D *object;
+        Magnum::Float distance; // in units of the ray direction
+    };
+
+    struct Stats
+    {
+        std::size_t objects = 0;
+        std::size_t nodes = 0;
+        std::size_t unindexed = 0;
+        std::size_t rebuilds = 0;
+        Magnum::Float costGrowth = 1.0f; // SAH cost relative to the last build
+    };
+
+    SceneBvh() = default;
+
+    SceneBvh(const SceneBvh &) = delete;
+    SceneBvh &operator=(const SceneBvh &) = delete;
+
+    // Refits the tree to the objects moved since the last call and rebuilds it when needed.
+    // Call once per frame before querying, after TransformCache::Update() cleaned the objects.
+    void Refit();
+
+    // Nearest object hit by the ray
+    bool Raycast(const Magnum::Vector3 &origin, const Magnum::Vector3 &direction, Hit &hit);
+
+    // Nearest hit for each ray, objects of rays that hit nothing are null
+    void Raycast(const std::vector<Bvh::Ray> &rays, std::vector<Hit> &hits);
+
+    // The overlap queries append every object whose world bounds overlap the volume
+    void QueryBox(const Magnum::Range3D &box, std::vector<Object3D *> &objects);
+    void QuerySphere(const Magnum::Vector3 &center, Magnum::Float radius, std::vector<Object3D *> &objects);
+    void QueryFrustum(const Magnum::Frustum &frustum, std::vector<Object3D *> &objects);
+
+    std::size_t ObjectCount() const
+    {
+        return _objectCount;
+    }
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    // Rebuild when the SAH cost grew by this factor through refits
+    Magnum::Float maxCostGrowth = 1.5f;
+
+    // Rebuild when more than this fraction of the objects is in the unindexed tail or left
+    // empty slots behind
+    Magnum::Float maxUnindexedFraction = 0.125f;
+
+  private:
+    friend BvhPickable;
+
+    void _add(BvhPickable &entry);
+    void _remove(BvhPickable &entry);
+    void _updateBounds(BvhPickable &entry);
+    void _refitLeaves();
+    void _rebuild();
+    Magnum::Float _cost() const;
+    void _addArea(double value);
+
+    bool _raycast(const Bvh::Ray &ray, Hit &hit);
+
+    // Calls the function for every live entry in nodes accepted by the predicate and in the
+    // unindexed tail
+    template <class NodeTest, class Function> void _forEachOverlapping(NodeTest test, Function function);
+
+    // Slots, null for removed objects. Slots below _indexedCount are referenced by the tree.
+    std::vector<BvhPickable *> _entries;
+    std::vector<Magnum::UnsignedInt> _freeSlots;
+    std::size_t _indexedCount = 0;
+    std::size_t _objectCount = 0;
+
+    std::vector<Bvh::Node> _nodes;
+    std::vector<Magnum::UnsignedInt> _items;
+    std::vector<Magnum::UnsignedInt> _parents;
+    std::vector<Magnum::UnsignedInt> _leafOf;
+    std::vector<Magnum::UnsignedInt> _dirtyLeaves;
+    std::vector<Magnum::UnsignedInt> _stack;
+
+    // Surface area of all non-empty nodes, kept up to date by refits with compensated summation
+    // so that adding and removing areas until the next rebuild doesn't drift
+    double _areaSum = 0.0;
+    double _areaError = 0.0;
+    Magnum::Float _buildCost = 0.0f;
+    Stats _stats;
+};
+
+// Makes an object pickable through a SceneBvh. Attach it to the object that owns the mesh, the
+// feature keeps the mesh BVH alive for as long as it is attached. The object needs a
+// CachedTransform as well, its TransformCache is what cleans the object once it moved.
+class BvhPickable : public Magnum::SceneGraph::AbstractFeature3D, public Pooled
+{
+  public:
+    explicit BvhPickable(Object3D &object, SceneBvh &bvh, std::shared_ptr<const MeshBvh> mesh);
+    ~BvhPickable();
+
+    Object3D &owner()
+    {
+        return _owner;
+    }
+
+    const Magnum::Range3D &WorldBounds() const
+    {
+        return _worldBounds;
+    }
+
+  private:
+    friend SceneBvh;
+
+    void clean(const Magnum::Matrix4 &absoluteTransformationMatrix) override;
+
+    Object3D &_owner;
+    SceneBvh &_bvh;
+    std::shared_ptr<const MeshBvh> _mesh;
+
+    Magnum::Matrix4 _worldInverted;
+    Magnum::Range3D _worldBounds;
+    Magnum::UnsignedInt _index = 0;
+};
@@ -0,0 +1,353 @@
+#include "SceneStore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Vector4.h>
+
+#include "JobSystem.h"
+#include "SphereCulling.h"
+
+using namespace Magnum;
+
+namespace
+{
+
+constexpr UnsignedInt NoIndex = ~0u;
+
+// Compacting for a handful of holes costs more than skipping them
+constexpr std::size_t MinHolesBeforeCompact = 16;
+
+} // namespace
+
+SceneHandle SceneStore::Create(const MeshHandle &mesh, UnsignedInt material, const Matrix4 &transformation,
+                               SceneHandle parent, UnsignedInt objectId)
+{
+    CORRADE_ASSERT(material < _materials.size(), "SceneStore::Create(): invalid material" << material, {});
+
+    UnsignedInt parentRow = NoIndex;
+    if (parent != SceneHandle{})
+    {
+        CORRADE_ASSERT(Contains(parent), "SceneStore::Create(): invalid parent handle", {});
+        parentRow = UnsignedInt(_row(parent));
+        ++_childCount[parentRow];
+    }
+
+    SceneHandle handle;
+    if (!_freeSlots.empty())
+    {
+        handle.index = _freeSlots.back();
+        _freeSlots.pop_back();
+    }
+    else
+    {
+        handle.index = UnsignedInt(_generations.size());
+        _generations.push_back(0);
+        _rowOf.push_back(NoIndex);
+    }
+    handle.generation = _generations[handle.index];
+
+    // Appending keeps parents before their children
+    const std::size_t row = _local.size();
+    _rowOf[handle.index] = UnsignedInt(row);
+    _local.push_back(transformation);
+    _world.emplace_back();
+    _normal.emplace_back();
+    _parent.push_back(parentRow);
+    _childCount.push_back(0);
+    _mesh.push_back(_meshIndex(mesh));
+    _material.push_back(material);
+    _objectId.push_back(objectId);
+    _slotOf.push_back(handle.index);
+    _flags.push_back(Dirty);
+
+    // Not visible until the first update computes the sphere
+    const std::size_t padded = SphereCulling::PaddedSize(_local.size());
+    _x.resize(padded, 0.0f);
+    _y.resize(padded, 0.0f);
+    _z.resize(padded, 0.0f);
+    _radius.resize(padded, -Constants::inf());
+
+    ++_objectCount;
+    ++_version;
+    _levelsDirty = true;
+    return handle;
+}
+
+void SceneStore::Destroy(SceneHandle handle)
+{
+    if (Contains(handle))
+        _release(_row(handle));
+}
+
+bool SceneStore::Contains(SceneHandle handle) const
+{
+    return handle.index < _generations.size() && _generations[handle.index] == handle.generation &&
+           _rowOf[handle.index] != NoIndex;
+}
+
+UnsignedInt SceneStore::AddMaterial(const PhongMaterial &material)
+{
+    _materials.push_back(material);
+    ++_version;
+    return UnsignedInt(_materials.size() - 1);
+}
+
+const Matrix4 &SceneStore::Transformation(SceneHandle handle) const
+{
+    return _local[_row(handle)];
+}
+
+void SceneStore::SetTransformation(SceneHandle handle, const Matrix4 &transformation)
+{
+    const std::size_t row = _row(handle);
+    if (_local[row] == transformation)
+        return;
+
+    _local[row] = transformation;
+    _flags[row] |= Dirty;
+    ++_version;
+}
+
+const Matrix4 &SceneStore::World(SceneHandle handle) const
+{
+    return _world[_row(handle)];
+}
+
+void SceneStore::Update()
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // Parents come first, so one pass reaches the children of children as well
+    if (_orphans)
+    {
+        for (std::size_t row = 0; row != _local.size(); ++row)
+        {
+            const UnsignedInt parent = _parent[row];
+            if (_slotOf[row] != NoIndex && parent != NoIndex && _slotOf[parent] == NoIndex)
+                _release(row);
+        }
+        _orphans = false;
+    }
+
+    if (_holes > MinHolesBeforeCompact && _holes > maxHoleFraction * _local.size())
+        _compact();
+
+    std::size_t recomputed = 0;
+    if (!jobs || _objectCount < parallelGrainSize)
+    {
+        for (std::size_t row = 0; row != _local.size(); ++row)
+        {
+            if (_slotOf[row] != NoIndex && _updateRow(row))
+                ++recomputed;
+        }
+    }
+    else
+    {
+        if (_levelsDirty)
+            _buildLevels();
+
+        std::atomic<std::size_t> recomputedInLevels{0};
+        for (std::size_t level = 0; level + 1 < _levelOffsets.size(); ++level)
+        {
+            const UnsignedInt *rows = _levelRows.data() + _levelOffsets[level];
+            jobs->ParallelFor(_levelOffsets[level + 1] - _levelOffsets[level], parallelGrainSize,
+                              [&](std::size_t begin, std::size_t end) {
+                                  std::size_t count = 0;
+                                  for (std::size_t i = begin; i != end; ++i)
+                                      count += _updateRow(rows[i]);
+                                  recomputedInLevels.fetch_add(count, std::memory_order_relaxed);
+                              });
+        }
+        recomputed = recomputedInLevels;
+    }
+
+    _stats.objects = _objectCount;
+    _stats.recomputed = recomputed;
+    _stats.updateMilliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SceneStore::Extract(const Matrix4 &projectionCamera, std::vector<std::vector<InstanceData>> &instances)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    Vector4 planes[6];
+    SphereCulling::ExtractPlanes(projectionCamera, planes);
+
+    // Holes have a radius of -inf and never pass
+    const std::size_t count = _local.size();
+    _visible.resize(_x.size());
+    SphereCulling::TestSpheres(planes, _x.data(), _y.data(), _z.data(), _radius.data(), count, _visible.data());
+
+    instances.resize(_meshes.size());
+    for (std::vector<InstanceData> &list : instances)
+        list.clear();
+
+    std::size_t visible = 0;
+    for (std::size_t row = 0; row != count; ++row)
+    {
+        if (!_visible[row])
+            continue;
+
+        instances[_mesh[row]].push_back(
+            {_world[row], _normal[row], _materials[_material[row]].diffuseColor, _objectId[row]});
+        ++visible;
+    }
+
+    _stats.visible = visible;
+    _stats.culled = _objectCount - visible;
+    _stats.extractMilliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool SceneStore::_updateRow(std::size_t row)
+{
+    const UnsignedInt parent = _parent[row];
+    const bool parentMoved = parent != NoIndex && (_flags[parent] & Moved);
+    if (!(_flags[row] & Dirty) && !parentMoved)
+    {
+        _flags[row] = 0;
+        return false;
+    }
+
+    const Matrix4 &world = _world[row] = parent == NoIndex ? _local[row] : _world[parent] * _local[row];
+    _normal[row] = world.normalMatrix();
+
+    // Non-uniform scaling stretches the sphere by the largest axis scale
+    const MeshResource &mesh = *_meshes[_mesh[row]];
+    const Matrix3x3 scaling = world.rotationScaling();
+    const Float scale = Math::sqrt(Math::max(Math::max(scaling[0].dot(), scaling[1].dot()), scaling[2].dot()));
+    const Vector3 center = world.transformPoint(mesh.boundingCenter);
+    _x[row] = center.x();
+    _y[row] = center.y();
+    _z[row] = center.z();
+    _radius[row] = mesh.boundingRadius * scale;
+
+    _flags[row] = Moved;
+    return true;
+}
+
+void SceneStore::_buildLevels()
+{
+    // Parents come first, so their depth is known by the time their children are reached
+    std::vector<UnsignedInt> depth(_local.size(), 0);
+    _levelOffsets.assign(1, 0);
+    for (std::size_t row = 0; row != _local.size(); ++row)
+    {
+        if (_slotOf[row] == NoIndex)
+            continue;
+
+        const UnsignedInt parent = _parent[row];
+        depth[row] = parent == NoIndex ? 0 : depth[parent] + 1;
+        if (depth[row] + 2 > _levelOffsets.size())
+            _levelOffsets.resize(depth[row] + 2, 0);
+        ++_levelOffsets[depth[row] + 1];
+    }
+
+    // Counting sort, rows stay in order within a level
+    for (std::size_t level = 1; level != _levelOffsets.size(); ++level)
+        _levelOffsets[level] += _levelOffsets[level - 1];
+
+    std::vector<std::size_t> next(_levelOffsets.begin(), _levelOffsets.end() - 1);
+    _levelRows.resize(_levelOffsets.back());
+    for (std::size_t row = 0; row != _local.size(); ++row)
+    {
+        if (_slotOf[row] != NoIndex)
+            _levelRows[next[depth[row]]++] = UnsignedInt(row);
+    }
+
+    _levelsDirty = false;
+}
+
+std::size_t SceneStore::_row(SceneHandle handle) const
+{
+    CORRADE_ASSERT(Contains(handle), "SceneStore: invalid handle", {});
+    return _rowOf[handle.index];
+}
+
+UnsignedInt SceneStore::_meshIndex(const MeshHandle &mesh)
+{
+    auto found = _meshIndices.find(mesh.get());
+    if (found != _meshIndices.end())
+        return found->second;
+
+    _meshes.push_back(mesh);
+    return _meshIndices[mesh.get()] = UnsignedInt(_meshes.size() - 1);
+}
+
+void SceneStore::_release(std::size_t row)
+{
+    const UnsignedInt slot = _slotOf[row];
+    ++_generations[slot];
+    _rowOf[slot] = NoIndex;
+    _freeSlots.push_back(slot);
+
+    _slotOf[row] = NoIndex;
+    _radius[row] = -Constants::inf();
+    if (_parent[row] != NoIndex)
+        --_childCount[_parent[row]];
+    if (_childCount[row])
+        _orphans = true;
+
+    ++_holes;
+    --_objectCount;
+    ++_version;
+    _levelsDirty = true;
+}
+
+void SceneStore::_compact()
+{
+    // Rows only move towards the front, so parents are moved before their children
+    std::vector<UnsignedInt> moved(_local.size(), NoIndex);
+    std::size_t count = 0;
+    for (std::size_t row = 0; row != _local.size(); ++row)
+    {
+        const UnsignedInt slot = _slotOf[row];
+        if (slot == NoIndex)
+            continue;
+
+        const UnsignedInt parent = _parent[row];
+        moved[row] = UnsignedInt(count);
+        _local[count] = _local[row];
+        _world[count] = _world[row];
+        _normal[count] = _normal[row];
+        _parent[count] = parent == NoIndex ? NoIndex : moved[parent];
+        _childCount[count] = _childCount[row];
+        _mesh[count] = _mesh[row];
+        _material[count] = _material[row];
+        _objectId[count] = _objectId[row];
+        _slotOf[count] = slot;
+        _flags[count] = _flags[row];
+        _x[count] = _x[row];
+        _y[count] = _y[row];
+        _z[count] = _z[row];
+        _radius[count] = _radius[row];
+        _rowOf[slot] = UnsignedInt(count);
+        ++count;
+    }
+
+    _local.resize(count);
+    _world.resize(count);
+    _normal.resize(count);
+    _parent.resize(count);
+    _childCount.resize(count);
+    _mesh.resize(count);
+    _material.resize(count);
+    _objectId.resize(count);
+    _slotOf.resize(count);
+    _flags.resize(count);
+
+    const std::size_t padded = SphereCulling::PaddedSize(count);
+    _x.resize(padded);
+    _y.resize(padded);
+    _z.resize(padded);
+    _radius.resize(padded);
+    std::fill(_radius.begin() + count, _radius.end(), -Constants::inf());
+
+    _holes = 0;
+    _levelsDirty = true;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include "InstanceRenderer.h"
+#include "MeshLibrary.h"
+#include "RenderQueue.h"
+
+class JobSystem;
+
+// Refers to an object in a SceneStore. The generation of a slot changes when its object is
+// destroyed, so handles to destroyed objects stay detectably invalid after the slot is reused.
+struct SceneHandle
+{
+    Magnum::UnsignedInt index = ~0u;
+    Magnum::UnsignedInt generation = 0;
+
+    bool operator==(const SceneHandle &other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const SceneHandle &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// Data-oriented alternative to the scene graph for scenes with a large number of objects.
+// Objects have no class of their own, they are a row in structure-of-arrays storage holding
+// local and world transformations, mesh, material and object ID. Rows are kept in the order the
+// objects were created, so parents always come before their children. That makes transform
+// propagation a single forward pass over the arrays; culling runs over packed bounding spheres
+// and draw extraction writes instance data straight from the arrays.
+//
+// Destroyed objects leave a hole in the arrays that is compacted away once there are enough of
+// them, handles stay valid across compaction.
+//
+// Given a job system, propagation runs level by level instead: objects at the same depth only
+// read the world transformations of the level above, so each level is split across workers.
+// Every object is computed by the same code either way, the results are bit-identical.
+class SceneStore
+{
+  public:
+    struct Stats
+    {
+        std::size_t objects = 0;
+
+        // Last Update() and Extract()
+        std::size_t recomputed = 0;
+        std::size_t visible = 0;
+        std::size_t culled = 0;
+        double updateMilliseconds = 0.0;
+        double extractMilliseconds = 0.0;
+    };
+
+    SceneStore() = default;
+
+    SceneStore(const SceneStore &) = delete;
+    SceneStore &operator=(const SceneStore &) = delete;
+
+    // A default-constructed parent makes a root object
+    SceneHandle Create(const MeshHandle &mesh, Magnum::UnsignedInt material, const Magnum::Matrix4 &transformation,
+                       SceneHandle parent = {}, Magnum::UnsignedInt objectId = 0);
+
+    // Children are destroyed along with it on the next Update(). Does nothing for invalid handles.
+    void Destroy(SceneHandle handle);
+
+    bool Contains(SceneHandle handle) const;
+
+    // Returns the material index to create objects with
+    Magnum::UnsignedInt AddMaterial(const PhongMaterial &material);
+
+    const Magnum::Matrix4 &Transformation(SceneHandle handle) const;
+    void SetTransformation(SceneHandle handle, const Magnum::Matrix4 &transformation);
+
+    // As of the last Update()
+    const Magnum::Matrix4 &World(SceneHandle handle) const;
+
+    // Propagates changed transformations to world transformations, normal matrices and
+    // bounding spheres of the objects and all their children
+    void Update();
+
+    // Instance data of the objects inside the frustum, one list for each of Meshes()
+    void Extract(const Magnum::Matrix4 &projectionCamera, std::vector<std::vector<InstanceData>> &instances);
+
+    // Every mesh objects were created with. They stay referenced for as long as the store lives.
+    const std::vector<MeshHandle> &Meshes() const
+    {
+        return _meshes;
+    }
+
+    std::size_t ObjectCount() const
+    {
+        return _objectCount;
+    }
+
+    // Changes whenever objects are created, destroyed or moved, or materials are added
+    unsigned long long Version() const
+    {
+        return _version;
+    }
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    // Compact the arrays once holes make up more than this fraction of them
+    Magnum::Float maxHoleFraction = 0.25f;
+
+    // Propagates transformations in parallel when set. Levels with fewer objects than the grain
+    // size stay on the calling thread.
+    JobSystem *jobs = nullptr;
+    std::size_t parallelGrainSize = 4096;
+
+  private:
+    enum : Magnum::UnsignedByte
+    {
+        Dirty = 1 << 0, // local transformation changed
+        Moved = 1 << 1  // world transformation changed in this update
+    };
+
+    std::size_t _row(SceneHandle handle) const;
+    Magnum::UnsignedInt _meshIndex(const MeshHandle &mesh);
+    bool _updateRow(std::size_t row);
+    void _buildLevels();
+    void _release(std::size_t row);
+    void _compact();
+
+    // Slots the handles refer to
+    std::vector<Magnum::UnsignedInt> _generations;
+    std::vector<Magnum::UnsignedInt> _rowOf;
+    std::vector<Magnum::UnsignedInt> _freeSlots;
+
+    // One row per object, holes have no slot
+    std::vector<Magnum::Matrix4> _local;
+    std::vector<Magnum::Matrix4> _world;
+    std::vector<Magnum::Matrix3x3> _normal;
+    std::vector<Magnum::UnsignedInt> _parent;
+    std::vector<Magnum::UnsignedInt> _childCount;
+    std::vector<Magnum::UnsignedInt> _mesh;
+    std::vector<Magnum::UnsignedInt> _material;
+    std::vector<Magnum::UnsignedInt> _objectId;
+    std::vector<Magnum::UnsignedInt> _slotOf;
+    std::vector<Magnum::UnsignedByte> _flags;
+
+    // World bounding spheres, padded for SphereCulling
+    std::vector<Magnum::Float> _x, _y, _z, _radius;
+    std::vector<Magnum::UnsignedByte> _visible;
+
+    // Rows sorted by depth, level i is [_levelOffsets[i], _levelOffsets[i + 1]). Rebuilt when
+    // objects are created or destroyed.
+    std::vector<Magnum::UnsignedInt> _levelRows;
+    std::vector<std::size_t> _levelOffsets;
+    bool _levelsDirty = true;
+
+    std::vector<MeshHandle> _meshes;
+    std::unordered_map<MeshResource *, Magnum::UnsignedInt> _meshIndices;
+    std::vector<PhongMaterial> _materials;
+
+    std::size_t _objectCount = 0;
+    std::size_t _holes = 0;
+    unsigned long long _version = 0;
+    bool _orphans = false;
+    Stats _stats;
+};
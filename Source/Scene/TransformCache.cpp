@@ -0,0 +1,79 @@
+#include "TransformCache.h"
+
+using namespace Magnum;
+
+void TransformCache::BeginFrame()
+{
+    _stats.recomputed = 0;
+}
+
+void TransformCache::Update()
+{
+    // Cleaning the objects calls back into CachedTransform::clean() with the new absolute
+    // transformation, together with every other feature of the object
+    for (CachedTransform *entry : _dirty)
+    {
+        entry->_dirtyIndex = CachedTransform::NotDirty;
+        entry->_owner.setClean();
+    }
+    _dirty.clear();
+}
+
+bool TransformCache::SetTransformation(Object3D &object, const Matrix4 &transformation)
+{
+    if (object.transformation() == transformation)
+        return false;
+
+    object.setTransformation(transformation);
+    return true;
+}
+
+void TransformCache::_markDirty(CachedTransform &entry)
+{
+    if (entry._dirtyIndex != CachedTransform::NotDirty)
+        return;
+
+    entry._dirtyIndex = _dirty.size();
+    _dirty.push_back(&entry);
+}
+
+void TransformCache::_forget(CachedTransform &entry)
+{
+    if (entry._dirtyIndex == CachedTransform::NotDirty)
+        return;
+
+    // Move the last entry into the gap, the order doesn't matter
+    CachedTransform *last = _dirty.back();
+    _dirty[entry._dirtyIndex] = last;
+    last->_dirtyIndex = entry._dirtyIndex;
+    _dirty.pop_back();
+}
+
+CachedTransform::CachedTransform(Object3D &object, TransformCache &cache)
+    : SceneGraph::AbstractFeature3D{object}, _owner(object), _cache(cache)
+{
+    setCachedTransformations(SceneGraph::CachedTransformation::Absolute);
+
+    ++_cache._stats.objects;
+
+    // New objects start dirty, so markDirty() won't be called until the first clean
+    _cache._markDirty(*this);
+}
+
+CachedTransform::~CachedTransform()
+{
+    _cache._forget(*this);
+    --_cache._stats.objects;
+}
+
+void CachedTransform::markDirty()
+{
+    _cache._markDirty(*this);
+}
+
+void CachedTransform::clean(const Matrix4 &absoluteTransformationMatrix)
+{
+    _world = absoluteTransformationMatrix;
+    _normal = absoluteTransformationMatrix.normalMatrix();
+    ++_cache._stats.recomputed;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/SceneGraph/AbstractFeature.h>
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+#include <Magnum/SceneGraph/Object.h>
+
+#include "ObjectPool.h"
+
+using Object3D = Magnum::SceneGraph::Object<Magnum::SceneGraph::MatrixTransformation3D>;
+
+class CachedTransform;
+
+// World transformations and normal matrices of scene objects. The scene graph marks an object
+// and everything below it dirty when its transformation changes; only those objects are
+// recomputed on Update(), every other cache stays as it is. Renderers read the cached matrices
+// instead of asking the scene graph to compute them again.
+//
+// This is the only place that keeps track of moved objects. Cleaning an object cleans all of
+// its features, so the BVH, culling and instancing features get their clean() called from
+// Update() as well and don't need a dirty list of their own.
+class TransformCache
+{
+  public:
+    struct Stats
+    {
+        std::size_t objects = 0;
+        std::size_t recomputed = 0; // since the last BeginFrame()
+    };
+
+    TransformCache() = default;
+
+    TransformCache(const TransformCache &) = delete;
+    TransformCache &operator=(const TransformCache &) = delete;
+
+    void BeginFrame();
+
+    // Recomputes the caches of objects moved since the last call
+    void Update();
+
+    // Whether objects moved since the last Update()
+    bool Pending() const
+    {
+        return !_dirty.empty();
+    }
+
+    const Stats &Statistics() const
+    {
+        return _stats;
+    }
+
+    // Sets the local transformation. Setting the one the object already has doesn't dirty the
+    // object or its children. Returns whether it changed.
+    static bool SetTransformation(Object3D &object, const Magnum::Matrix4 &transformation);
+
+  private:
+    friend CachedTransform;
+
+    void _markDirty(CachedTransform &entry);
+    void _forget(CachedTransform &entry);
+
+    // Objects moved since the last Update(), each entry knows its index in here
+    std::vector<CachedTransform *> _dirty;
+    Stats _stats;
+};
+
+// Cached world transformation and normal matrix of an object. Features that read it in their own
+// clean() have to be attached after it, features are cleaned in the order they were added.
+class CachedTransform : public Magnum::SceneGraph::AbstractFeature3D, public Pooled
+{
+  public:
+    explicit CachedTransform(Object3D &object, TransformCache &cache);
+    ~CachedTransform();
+
+    const Magnum::Matrix4 &World() const
+    {
+        return _world;
+    }
+
+    const Magnum::Matrix3x3 &Normal() const
+    {
+        return _normal;
+    }
+
+  private:
+    friend TransformCache;
+
+    void markDirty() override;
+    void clean(const Magnum::Matrix4 &absoluteTransformationMatrix) override;
+
+    Object3D &_owner;
+    TransformCache &_cache;
+
+    Magnum::Matrix4 _world;
+    Magnum::Matrix3x3 _normal;
+    std::size_t _dirtyIndex = NotDirty;
+
+    static constexpr std::size_t NotDirty = ~std::size_t{};
+};
@@ -56,6 +56,32 @@ class Toolbar
             app->AddCapsule();
         }
 
+        // Stress test for the bulk path
+        if (ImGui::Button("10k", buttonSize))
+        {
+            std::vector<Magnum::Matrix4> transformations;
+            transformations.reserve(100 * 100);
+            for (int z = 0; z != 100; ++z)
+                for (int x = 0; x != 100; ++x)
+                    transformations.push_back(
+                        Magnum::Matrix4::translation({(x - 50) * 3.0f, 0.0f, (z - 50) * 3.0f}) *
+                        Magnum::Matrix4::scaling(Magnum::Vector3{0.5f}));
+            app->Spawn(PrimitiveType::Cube, transformations);
+        }
+
+        // Stress test for the scene store, below the scene graph grid. These can't be selected.
+        if (ImGui::Button("100k", buttonSize))
+        {
+            std::vector<Magnum::Matrix4> transformations;
+            transformations.reserve(400 * 250);
+            for (int z = 0; z != 250; ++z)
+                for (int x = 0; x != 400; ++x)
+                    transformations.push_back(
+                        Magnum::Matrix4::translation({(x - 200) * 3.0f, -3.0f, (z - 125) * 3.0f}) *
+                        Magnum::Matrix4::scaling(Magnum::Vector3{0.5f}));
+            app->AddToStore(PrimitiveType::Cube, transformations);
+        }
+
         ImGui::End();
         ImGui::PopStyleVar();
     }
@@ -3,6 +3,8 @@
 
 #include "CameraControllerLayer.h"
 #include "GuiLayer.h"
+#include "ProfilerLayer.h"
+#include "StatsLayer.h"
 
 namespace Magnum
 {
@@ -32,6 +34,8 @@ MyApplication::MyApplication(const Arguments &arguments) : Application{arguments
     // ADD ALL THE LAYERS
     layers.PushLayer(new CameraControllerLayer());
     layers.PushLayer(new GuiLayer());
+    layers.PushLayer(new StatsLayer());
+    layers.PushLayer(new ProfilerLayer());
 }
 
 } // namespace Magnum